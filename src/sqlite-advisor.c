@@ -0,0 +1,168 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Index advisor.
+//
+// When SQLite plans a loop using an automatic index, it reports it through
+// the error log as "automatic index on TABLE(COLUMN)" (SQLITE_WARNING_AUTOINDEX).
+// A statement collected by the trace callback is planned again with the log
+// routed to the analysis on the same thread, which gives the table and the
+// column. EXPLAIN QUERY PLAN of the same prepare describes all columns used
+// by the automatic index. The benefit of each suggested index is measured
+// by running a read-only statement without and with the index inside a
+// savepoint, which is rolled back (the difference of VM steps of one run).
+//
+// All of it is done on a private connection to the same file, so the
+// savepoint never becomes a part of a transaction of the user's connection
+// (which may be just used by its async worker). In-memory databases have no
+// such connection; their statements are only planned, not measured.
+
+#include "sqlite-rebol-extension.h"
+#include <string.h>
+
+#define ADVICE_INDEXES 8  // automatic indexes of one statement
+
+typedef struct auto_index {
+	char table[64];
+	char columns[256];  // quoted and separated by commas
+} AUTO_INDEX;
+
+typedef struct auto_indexes {
+	AUTO_INDEX index[ADVICE_INDEXES];
+	int logged;   // from the log
+	int planned;  // from the query plan
+} AUTO_INDEXES;
+
+// the analysis running on this thread
+static THREAD_LOCAL AUTO_INDEXES *collecting = NULL;
+
+static void quote_column(char *columns, const char *name, size_t len) {
+	char *quoted = sqlite3_mprintf("%s\"%.*w\"", columns[0] ? "," : "", (int)len, name);
+	if (!quoted) return;
+	if (strlen(columns) + strlen(quoted) < sizeof(((AUTO_INDEX*)0)->columns))
+		strcat(columns, quoted);
+	sqlite3_free(quoted);
+}
+
+// Error log callback of the library (installed before its initialization).
+void advisor_log(void *arg, int code, const char *msg) {
+	AUTO_INDEX *index;
+	const char *table, *column, *end;
+
+	UNUSED(arg);
+	if (code != SQLITE_WARNING_AUTOINDEX || !collecting || !msg) return;
+	if (collecting->logged == ADVICE_INDEXES) return;
+	// "automatic index on TABLE(COLUMN)"
+	if (strncmp(msg, "automatic index on ", 19)) return;
+	table  = msg + 19;
+	column = strrchr(table, '(');
+	end    = column ? strchr(column, ')') : NULL;
+	if (!end || column == table || column - table >= (int)sizeof(index->table)) return;
+
+	index = &collecting->index[collecting->logged++];
+	memcpy(index->table, table, column - table);
+	index->table[column - table] = 0;
+	index->columns[0] = 0;
+	quote_column(index->columns, column + 1, end - column - 1);
+}
+
+// Takes column names from "... AUTOMATIC [PARTIAL] [COVERING] INDEX (a=? AND b>?)".
+static void planned_columns(AUTO_INDEXES *indexes, const char *detail) {
+	AUTO_INDEX *index;
+	const char *p, *name;
+	char columns[sizeof(indexes->index[0].columns)] = "";
+
+	if (!detail || !(p = strstr(detail, "AUTOMATIC ")) || !(p = strchr(p, '('))) return;
+	if (indexes->planned == ADVICE_INDEXES) return;
+	index = &indexes->index[indexes->planned++];
+	if (indexes->planned > indexes->logged) return;
+	for (p++; *p && *p != ')'; ) {
+		for (name = p; *p && !strchr("=<>!) ", *p); p++);
+		if (p > name) quote_column(columns, name, p - name);
+		p = strstr(p, " AND ");
+		if (!p) break;
+		p += 5;
+	}
+	// the log names only the first column
+	if (columns[0]) strcpy(index->columns, columns);
+}
+
+// Runs the statement to its end, returns number of VM steps or -1 on error.
+static i64 measure(sqlite3 *db, const char *sql) {
+	sqlite3_stmt *stmt = NULL;
+	i64 steps = -1;
+	int rc;
+
+	if (SQLITE_OK != sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) || !stmt) return -1;
+	do { rc = sqlite3_step(stmt); } while (rc == SQLITE_ROW);
+	if (rc == SQLITE_DONE) steps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 0);
+	sqlite3_finalize(stmt);
+	return steps;
+}
+
+// Returns a block of suggested CREATE INDEX statements, each followed by
+// the number of VM steps it saves in one run (none when not measured).
+// The statement is analyzed on the private connection `adb`, or only
+// planned on `db` when it is NULL. Must be used only on the main thread!
+REBSER* advise_indexes(sqlite3 *db, sqlite3 *adb, const char *sql) {
+	AUTO_INDEXES indexes;
+	sqlite3_stmt *stmt = NULL;
+	REBSER *blk = RL_MAKE_BLOCK(4);
+	RXIARG arg;
+	char *query, *create;
+	REBOOL readonly = FALSE, savepoint = FALSE;
+	i64 before = -1, after;
+	int i, count;
+
+	if (!sql) return blk;
+	CLEARS(&indexes);
+	if (adb) db = adb;
+
+	// automatic indexes are planned (and logged) while the statement is prepared
+	if (!(query = sqlite3_mprintf("EXPLAIN QUERY PLAN %s", sql))) return blk;
+	collecting = &indexes;
+	if (SQLITE_OK == sqlite3_prepare_v2(db, query, -1, &stmt, NULL) && stmt) {
+		while (SQLITE_ROW == sqlite3_step(stmt))
+			planned_columns(&indexes, (const char*)sqlite3_column_text(stmt, 3));
+	}
+	collecting = NULL;
+	sqlite3_finalize(stmt);
+	sqlite3_free(query);
+
+	count = indexes.logged;
+	if (count && SQLITE_OK == sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) && stmt) {
+		readonly = sqlite3_stmt_readonly(stmt);
+		sqlite3_finalize(stmt);
+	}
+	savepoint = adb && readonly && SQLITE_OK == sqlite3_exec(db, "SAVEPOINT rebol_advisor", NULL, NULL, NULL);
+	if (savepoint) before = measure(db, sql);
+
+	for (i = 0; i < count; i++) {
+		create = sqlite3_mprintf("CREATE INDEX \"%w_advice_%d\" ON \"%w\"(%s)",
+			indexes.index[i].table, i + 1, indexes.index[i].table, indexes.index[i].columns);
+		if (!create) break;
+		after = -1;
+		if (before >= 0 && SQLITE_OK == sqlite3_exec(db, create, NULL, NULL, NULL)) {
+			after = measure(db, sql);
+			sqlite3_exec(db, "ROLLBACK TO rebol_advisor", NULL, NULL, NULL);
+		}
+		arg.series = RL_DECODE_UTF_STRING((REBYTE*)create, (REBCNT)strlen(create), 8, 0, 0);
+		arg.index  = 0;
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_STRING);
+		arg.int64 = before - after;
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, after < 0 ? RXT_NONE : RXT_INTEGER);
+		sqlite3_free(create);
+	}
+	if (savepoint) {
+		sqlite3_exec(db, "ROLLBACK TO rebol_advisor", NULL, NULL, NULL);
+		sqlite3_exec(db, "RELEASE rebol_advisor", NULL, NULL, NULL);
+	}
+	return blk;
+}
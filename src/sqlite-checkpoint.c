@@ -0,0 +1,146 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// WAL auto-checkpoint with statistics (`auto-checkpoint` command).
+//
+// The WAL hook replaces SQLite's own auto-checkpoint, which works the same
+// way: when the WAL has reached the threshold after a commit, a passive
+// checkpoint is done by the committing connection. In the background mode,
+// the checkpoint is done by a helper thread using its own connection, so
+// commits are not delayed. Passive checkpoints never wait for readers or
+// writers; frames which could not be copied yet are copied by the next one.
+// When the WAL grows over 4 times the threshold anyway, the helper thread
+// uses a truncate checkpoint, which waits for the writers.
+
+#include "sqlite-rebol-extension.h"
+
+static void checkpoint(SQLITE_CHECKPOINTER *cp, sqlite3 *db, const char *schema, int mode) {
+	int log = 0, done = 0, rc;
+
+	rc = sqlite3_wal_checkpoint_v2(db, schema, mode, &log, &done);
+	lock_enter(cp->lock);
+	cp->checkpoints++;
+	if (rc != SQLITE_OK || done < log) cp->incomplete++;
+	cp->log = log;
+	cp->checkpointed = done;
+	lock_leave(cp->lock);
+}
+
+// Called after each commit on the committing thread.
+static int wal_hook(void *data, sqlite3 *db, const char *schema, int frames) {
+	SQLITE_CHECKPOINTER *cp = (SQLITE_CHECKPOINTER*)data;
+	REBOOL run;
+
+	lock_enter(cp->lock);
+	cp->commits++;
+	// the WAL is reset by the first commit after a complete checkpoint
+	cp->logged += (frames >= cp->wal_frames) ? frames - cp->wal_frames : frames;
+	cp->wal_frames = frames;
+	run = cp->frames > 0 && frames >= cp->frames;
+	if (run && cp->thread) {
+		cp->pending = TRUE;
+		lock_notify(cp->lock);
+		run = FALSE;
+	}
+	lock_leave(cp->lock);
+	if (run) checkpoint(cp, db, schema, SQLITE_CHECKPOINT_PASSIVE);
+	return SQLITE_OK;
+}
+
+static void checkpointer_main(void *data) {
+	SQLITE_CHECKPOINTER *cp = (SQLITE_CHECKPOINTER*)data;
+	int mode;
+
+	lock_enter(cp->lock);
+	for (;;) {
+		while (!cp->pending && !cp->stop) lock_wait(cp->lock);
+		if (cp->stop) break;
+		cp->pending = FALSE;
+		// Under sustained writes the WAL is rarely completely checkpointed
+		// when the next transaction starts, so it would never be reused.
+		// When it is too long, writers are paused until it is truncated.
+		mode = (cp->wal_frames >= 4 * cp->frames) ? SQLITE_CHECKPOINT_TRUNCATE : SQLITE_CHECKPOINT_PASSIVE;
+		lock_leave(cp->lock);
+		checkpoint(cp, cp->db, "main", mode);
+		lock_enter(cp->lock);
+	}
+	lock_leave(cp->lock);
+}
+
+static void stop_thread(SQLITE_CHECKPOINTER *cp) {
+	SQLITE_THREAD *thread;
+
+	lock_enter(cp->lock);
+	thread = cp->thread;
+	cp->stop = TRUE;
+	lock_notify(cp->lock);
+	lock_leave(cp->lock);
+	if (thread) thread_join(thread);
+
+	lock_enter(cp->lock);
+	cp->thread  = NULL;
+	cp->stop    = FALSE;
+	cp->pending = FALSE;
+	lock_leave(cp->lock);
+	if (cp->db) {
+		sqlite3_close(cp->db);
+		cp->db = NULL;
+	}
+}
+
+// Sets the threshold (0 = statistics only) and starts or stops the helper thread.
+int checkpointer_start(SQLITE_CONTEXT *ctx, int frames, REBOOL background) {
+	SQLITE_CHECKPOINTER *cp = ctx->checkpointer;
+	SQLITE_THREAD *thread = NULL;
+	const char *file;
+	int rc;
+
+	if (!cp) {
+		if (!(cp = calloc(1, sizeof(SQLITE_CHECKPOINTER)))) return SQLITE_NOMEM;
+		if (!(cp->lock = lock_new())) {
+			free(cp);
+			return SQLITE_NOMEM;
+		}
+		ctx->checkpointer = cp;
+		sqlite3_wal_hook(ctx->db, wal_hook, cp);
+	}
+	stop_thread(cp);
+
+	if (background && frames > 0) {
+		file = sqlite3_db_filename(ctx->db, "main");
+		if (!file || !*file) return SQLITE_CANTOPEN; // in-memory or temporary database
+		rc = sqlite3_open_v2(file, &cp->db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, ctx->vfs);
+		// the WAL is opened by the first read of the database
+		if (rc == SQLITE_OK) rc = sqlite3_exec(cp->db, "PRAGMA schema_version", NULL, NULL, NULL);
+		if (rc == SQLITE_OK) sqlite3_busy_timeout(cp->db, 1000); // used by truncate checkpoints
+		if (rc == SQLITE_OK && !(thread = thread_start(checkpointer_main, cp))) rc = SQLITE_NOMEM;
+		if (rc != SQLITE_OK) {
+			sqlite3_close(cp->db);
+			cp->db = NULL;
+			return rc;
+		}
+	}
+	lock_enter(cp->lock);
+	cp->thread = thread;
+	cp->frames = frames;
+	lock_leave(cp->lock);
+	return SQLITE_OK;
+}
+
+// Removes the hook and stops the helper thread (async queries must be finished).
+void checkpointer_stop(SQLITE_CONTEXT *ctx) {
+	SQLITE_CHECKPOINTER *cp = ctx->checkpointer;
+	if (!cp) return;
+	if (ctx->db) sqlite3_wal_hook(ctx->db, NULL, NULL);
+	stop_thread(cp);
+	lock_free(cp->lock);
+	free(cp);
+	ctx->checkpointer = NULL;
+}
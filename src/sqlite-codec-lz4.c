@@ -0,0 +1,169 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Minimal LZ4 block format codec used by the compressed VFS.
+// Produces standard LZ4 blocks (no frame), so pages may be inspected
+// with any LZ4 tool if needed.
+
+#include "sqlite-rebol-extension.h"
+#include <string.h>
+
+#define LZ4_MINMATCH     4
+#define LZ4_LASTLITERALS 5
+#define LZ4_MFLIMIT      12
+#define LZ4_HASH_LOG     12
+#define LZ4_MAX_DISTANCE 65535
+
+static u32 lz4_read32(const REBYTE *p) {
+	u32 v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static u32 lz4_hash(u32 seq) {
+	return (seq * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+static REBYTE* lz4_write_length(REBYTE *op, int len) {
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (REBYTE)len;
+	return op;
+}
+
+int lz4_compress_bound(int size) {
+	return size + (size / 255) + 16;
+}
+
+// Returns number of bytes written into `dst` or 0 when the result
+// does not fit into `capacity` (the data is not worth compressing).
+int lz4_compress(const REBYTE *src, int size, REBYTE *dst, int capacity) {
+	u32 table[1 << LZ4_HASH_LOG];
+	const REBYTE *ip = src;
+	const REBYTE *anchor = src;
+	const REBYTE *end = src + size;
+	const REBYTE *mflimit = end - LZ4_MFLIMIT;
+	const REBYTE *matchlimit = end - LZ4_LASTLITERALS;
+	REBYTE *op = dst;
+	REBYTE *oend = dst + capacity;
+	const REBYTE *ref;
+	REBYTE *token;
+	int lit, len;
+	u32 seq, h;
+
+	memset(table, 0, sizeof(table));
+
+	if (size >= LZ4_MFLIMIT + 1) {
+		while (ip < mflimit) {
+			seq = lz4_read32(ip);
+			h = lz4_hash(seq);
+			ref = src + table[h];
+			table[h] = (u32)(ip - src);
+			if (ref >= ip || (ip - ref) > LZ4_MAX_DISTANCE || lz4_read32(ref) != seq) {
+				ip++;
+				continue;
+			}
+			// extend the match backwards...
+			while (ip > anchor && ref > src && ip[-1] == ref[-1]) { ip--; ref--; }
+			// and forwards
+			len = LZ4_MINMATCH;
+			while (ip + len < matchlimit && ip[len] == ref[len]) len++;
+
+			lit = (int)(ip - anchor);
+			if (op + 1 + lit + (lit / 255) + 1 + 2 + ((len - LZ4_MINMATCH) / 255) + 1 > oend) return 0;
+
+			token = op++;
+			if (lit >= 15) {
+				*token = 15 << 4;
+				op = lz4_write_length(op, lit - 15);
+			} else {
+				*token = (REBYTE)(lit << 4);
+			}
+			memcpy(op, anchor, lit);
+			op += lit;
+
+			op[0] = (REBYTE)((ip - ref) & 0xFF);
+			op[1] = (REBYTE)((ip - ref) >> 8);
+			op += 2;
+
+			if (len - LZ4_MINMATCH >= 15) {
+				*token |= 15;
+				op = lz4_write_length(op, len - LZ4_MINMATCH - 15);
+			} else {
+				*token |= (REBYTE)(len - LZ4_MINMATCH);
+			}
+			ip += len;
+			anchor = ip;
+			if (ip < mflimit) table[lz4_hash(lz4_read32(ip - 2))] = (u32)(ip - 2 - src);
+		}
+	}
+	// last literals...
+	lit = (int)(end - anchor);
+	if (op + 1 + lit + (lit / 255) + 1 > oend) return 0;
+	token = op++;
+	if (lit >= 15) {
+		*token = 15 << 4;
+		op = lz4_write_length(op, lit - 15);
+	} else {
+		*token = (REBYTE)(lit << 4);
+	}
+	memcpy(op, anchor, lit);
+	op += lit;
+	return (int)(op - dst);
+}
+
+// Returns number of decompressed bytes or -1 on malformed input.
+int lz4_decompress(const REBYTE *src, int size, REBYTE *dst, int capacity) {
+	const REBYTE *ip = src;
+	const REBYTE *iend = src + size;
+	REBYTE *op = dst;
+	REBYTE *oend = dst + capacity;
+	const REBYTE *ref;
+	unsigned token, s;
+	size_t lit, len, offset;
+
+	while (ip < iend) {
+		token = *ip++;
+		lit = token >> 4;
+		if (lit == 15) {
+			do {
+				if (ip >= iend) return -1;
+				s = *ip++;
+				lit += s;
+			} while (s == 255);
+		}
+		if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op)) return -1;
+		memcpy(op, ip, lit);
+		ip += lit;
+		op += lit;
+		if (ip >= iend) break; // the last sequence has no match part
+
+		if (iend - ip < 2) return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - dst)) return -1;
+
+		len = token & 15;
+		if (len == 15) {
+			do {
+				if (ip >= iend) return -1;
+				s = *ip++;
+				len += s;
+			} while (s == 255);
+		}
+		len += LZ4_MINMATCH;
+		if (len > (size_t)(oend - op)) return -1;
+		ref = op - offset;
+		while (len--) *op++ = *ref++; // may overlap
+	}
+	return (int)(op - dst);
+}
@@ -0,0 +1,54 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_auto_checkpoint(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+	SQLITE_CHECKPOINTER *cp, stats;
+	REBSER *blk;
+	i64 frames;
+	int rc;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	if (!ctx->db) RETURN_STR_ERROR("[SQLITE] Database is not open!");
+
+	if (RXA_TYPE(frm, 2) == RXT_INTEGER) {
+		frames = RXA_INT64(frm, 2);
+		if (frames < 0) RETURN_STR_ERROR("[SQLITE] Number of frames must not be negative!");
+		if (RXA_REF(frm, 3) && (!sqlite3_threadsafe() || threading_mode == SQLITE_CONFIG_SINGLETHREAD))
+			RETURN_STR_ERROR("[SQLITE] Background checkpoints are not available in the single-thread mode!");
+		rc = checkpointer_start(ctx, (int)MIN(frames, MAX_I32), RXA_REF(frm, 3));
+		if (rc != SQLITE_OK)
+			RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(rc));
+	}
+	if (!(cp = ctx->checkpointer)) return RXR_NONE;
+
+	lock_enter(cp->lock);
+	stats = *cp;
+	lock_leave(cp->lock);
+
+	blk = RL_MAKE_BLOCK(16);
+	append_field(blk, "commits",      stats.commits,      RXT_INTEGER);
+	append_field(blk, "logged",       stats.logged,       RXT_INTEGER);
+	append_field(blk, "wal-frames",   stats.wal_frames,   RXT_INTEGER);
+	append_field(blk, "checkpoints",  stats.checkpoints,  RXT_INTEGER);
+	append_field(blk, "incomplete",   stats.incomplete,   RXT_INTEGER);
+	append_field(blk, "log",          stats.log,          RXT_INTEGER);
+	append_field(blk, "checkpointed", stats.checkpointed, RXT_INTEGER);
+
+	RXA_SERIES(frm, 1) = blk;
+	RXA_TYPE(frm, 1)   = RXT_BLOCK;
+	RXA_INDEX(frm, 1)  = 0;
+	return RXR_VALUE;
+}
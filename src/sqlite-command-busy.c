@@ -0,0 +1,173 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Busy policy used when the database is locked by another connection.
+//
+// Instead of failing at once with SQLITE_BUSY, the connection retries until
+// the timeout using SQLite's default delays or an exponential backoff with
+// random jitter (so more waiting writers do not retry at the same moment).
+// A Rebol callback may be used to decide instead, but only when the lock is
+// hit on the interpreter's thread; helper threads use the timeout, so it is
+// required with a callback (and with a backoff). Waits are measured by the
+// monotonic clock, so changes of the system time do not affect them.
+//
+// The handler runs while the connection's mutex is held, which also guards
+// the statistics.
+
+#include "sqlite-rebol-extension.h"
+
+// delays used by SQLite's own busy timeout
+static const u8 delays[] = { 1, 2, 5, 10, 15, 20, 25, 25, 25, 50, 50, 100 };
+
+// Returns ms to sleep before the next retry or -1 to give up.
+static int call_rebol(SQLITE_BUSY_POLICY *busy, int count, i64 waited) {
+	RXICBI  cbi;
+	RXIFRM  args;
+	int type;
+
+	CLEARS(&cbi);
+	CLEARS(&args);
+	RXA_COUNT(&args)   = 2;
+	RXA_TYPE(&args, 1) = RXT_INTEGER;
+	RXA_INT64(&args, 1) = count;
+	RXA_TYPE(&args, 2) = RXT_INTEGER;
+	RXA_INT64(&args, 2) = waited;
+	cbi.obj  = busy->object;
+	cbi.word = busy->word;
+	cbi.args = args.args;
+
+	type = RL_CALLBACK(&cbi);
+	if (type == RXT_INTEGER && cbi.result.int64 >= 0)
+		return (int)MIN(cbi.result.int64, 60000);
+	return -1;
+}
+
+static int backoff(SQLITE_BUSY_POLICY *busy, int count) {
+	i64 delay = (i64)busy->delay_min << MIN(count, 20);
+	u32 jitter;
+	if (delay > busy->delay_max) delay = busy->delay_max;
+	// a random delay from the upper half
+	sqlite3_randomness(sizeof(jitter), &jitter);
+	return (int)(delay / 2 + jitter % (delay - delay / 2 + 1));
+}
+
+int busy_handler(void *data, int count) {
+	SQLITE_BUSY_POLICY *busy = (SQLITE_BUSY_POLICY*)data;
+	i64 now = monotonic_ms(), waited;
+	int delay;
+
+	if (count == 0) {
+		busy->started = now;
+		busy->waits++;
+	}
+	waited = now - busy->started;
+
+	if (busy->object && !thread_is_helper())
+		delay = call_rebol(busy, count, waited);
+	else if (waited >= busy->timeout)
+		delay = -1;
+	else {
+		delay = busy->delay_max ? backoff(busy, count) : delays[MIN(count, 11)];
+		delay = (int)MIN(delay, busy->timeout - waited);
+	}
+	if (delay < 0) {
+		busy->failures++;
+		return 0;
+	}
+	sqlite3_sleep(delay);
+
+	now = monotonic_ms();
+	busy->retries++;
+	busy->wait_time += now - busy->started - waited;
+	if (now - busy->started > busy->max_wait) busy->max_wait = now - busy->started;
+	return 1;
+}
+
+// Unprotects the callback object (not to be used from the GC).
+void busy_release(SQLITE_CONTEXT *ctx) {
+	if (ctx->busy.object) RL_PROTECT_GC(ctx->busy.object, 0);
+	ctx->busy.object = NULL;
+}
+
+// Parses: [timeout ms backoff min-ms max-ms callback object 'function]
+static REBOOL parse_policy(REBSER *blk, REBCNT index, SQLITE_BUSY_POLICY *busy) {
+	RXIARG arg, arg2;
+	REBCNT word;
+
+	while (index < SERIES_TAIL(blk)) {
+		if (!fetch_word(blk, index++, words_sqlite_arg, &word)) return FALSE;
+		switch (word) {
+		case W_ARG_TIMEOUT:
+			if (RXT_INTEGER != RL_GET_VALUE_RESOLVED(blk, index++, &arg)) return FALSE;
+			busy->timeout = (int)MAX(0, MIN(arg.int64, MAX_I32));
+			break;
+		case W_ARG_BACKOFF:
+			if (RXT_INTEGER != RL_GET_VALUE_RESOLVED(blk, index++, &arg)
+			 || RXT_INTEGER != RL_GET_VALUE_RESOLVED(blk, index++, &arg2)
+			 || arg.int64 < 1 || arg2.int64 < arg.int64 || arg2.int64 > 60000
+			) return FALSE;
+			busy->delay_min = (int)arg.int64;
+			busy->delay_max = (int)arg2.int64;
+			break;
+		case W_ARG_CALLBACK:
+			if (RXT_OBJECT != RL_GET_VALUE_RESOLVED(blk, index++, &arg)) return FALSE;
+			busy->object = arg.addr;
+			switch (RL_GET_VALUE(blk, index++, &arg)) {
+			case RXT_WORD:
+			case RXT_LIT_WORD:
+				busy->word = arg.int32a;
+				break;
+			default:
+				return FALSE;
+			}
+			break;
+		default:
+			return FALSE;
+		}
+	}
+	// without a timeout, the backoff would not wait at all and helper threads
+	// would give up at once instead of calling the callback
+	return busy->timeout > 0 || (!busy->delay_max && !busy->object);
+}
+
+int cmd_sqlite_busy(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+	SQLITE_BUSY_POLICY busy;
+	sqlite3_mutex *mutex;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	if (!ctx->db) RETURN_STR_ERROR("[SQLITE] Database is not open!");
+
+	CLEARS(&busy);
+	switch (RXA_TYPE(frm, 2)) {
+	case RXT_INTEGER:
+		busy.timeout = (int)MAX(0, MIN(RXA_INT64(frm, 2), MAX_I32));
+		break;
+	case RXT_BLOCK:
+		if (!parse_policy(RXA_SERIES(frm, 2), RXA_INDEX(frm, 2), &busy))
+			RETURN_STR_ERROR("[SQLITE] Invalid busy policy!");
+		break;
+	}
+
+	// the handler may be just used by the worker thread
+	mutex = sqlite3_db_mutex(ctx->db);
+	sqlite3_mutex_enter(mutex);
+	busy_release(ctx);
+	ctx->busy.timeout   = busy.timeout;
+	ctx->busy.delay_min = busy.delay_min;
+	ctx->busy.delay_max = busy.delay_max;
+	ctx->busy.word      = busy.word;
+	ctx->busy.object    = busy.object;
+	if (busy.object) RL_PROTECT_GC(busy.object, 1);
+	sqlite3_busy_handler(ctx->db, busy.timeout ? busy_handler : NULL, &ctx->busy);
+	sqlite3_mutex_leave(mutex);
+	return RXR_UNSET;
+}
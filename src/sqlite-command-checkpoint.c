@@ -0,0 +1,50 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_checkpoint(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+	REBSER *blk;
+	int mode = SQLITE_CHECKPOINT_PASSIVE;
+	int log = 0, done = 0, rc;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	if (!ctx->db) RETURN_STR_ERROR("[SQLITE] Database is not open!");
+
+	if (RXA_REF(frm, 2)) { // mode
+		switch (RL_FIND_WORD(words_sqlite_arg, RXA_WORD(frm, 3))) {
+			case W_ARG_PASSIVE:  mode = SQLITE_CHECKPOINT_PASSIVE;  break;
+			case W_ARG_FULL:     mode = SQLITE_CHECKPOINT_FULL;     break;
+			case W_ARG_RESTART:  mode = SQLITE_CHECKPOINT_RESTART;  break;
+			case W_ARG_TRUNCATE: mode = SQLITE_CHECKPOINT_TRUNCATE; break;
+			default:
+				RETURN_STR_ERROR("[SQLITE] Checkpoint mode must be one of: passive full restart truncate!");
+		}
+	}
+	// SQLITE_BUSY only means that the checkpoint was not completed
+	rc = sqlite3_wal_checkpoint_v2(ctx->db, NULL, mode, &log, &done);
+	if (rc != SQLITE_OK && rc != SQLITE_BUSY)
+		RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errmsg(ctx->db));
+
+	// both counts are -1 when the database is not in the WAL mode
+	blk = RL_MAKE_BLOCK(6);
+	append_field(blk, "log",          log,  RXT_INTEGER);
+	append_field(blk, "checkpointed", done, RXT_INTEGER);
+	append_field(blk, "busy",         rc == SQLITE_BUSY, RXT_LOGIC);
+
+	RXA_SERIES(frm, 1) = blk;
+	RXA_TYPE(frm, 1)   = RXT_BLOCK;
+	RXA_INDEX(frm, 1)  = 0;
+	return RXR_VALUE;
+}
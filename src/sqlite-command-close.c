@@ -17,9 +17,22 @@ int cmd_sqlite_close(RXIFRM* frm, void* reb_ctx) {
 	SQLITE_CONTEXT *ctx;
 
 	RESOLVE_SQLITE_CTX(ctx, 1);
+	if(ctx && ctx->worker) {
+		// waits for queued async queries
+		worker_stop(ctx->worker);
+		worker_release(ctx->worker);
+		ctx->worker = NULL;
+	}
+	if(ctx) {
+		readers_close(ctx);
+		checkpointer_stop(ctx);
+		busy_release(ctx);
+	}
 	if(ctx && ctx->db) {
+		sqlite3_set_clientdata(ctx->db, SQLITE_CTX_KEY, NULL, NULL);
 		sqlite3_close(ctx->db);
 		ctx->db = NULL;
 	}
+	if(ctx) trace_release(ctx);
 	return RXR_UNSET;
 }
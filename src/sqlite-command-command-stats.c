@@ -0,0 +1,26 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_command_stats(RXIFRM* frm, void* reb_ctx) {
+	REBSER *blk = RL_MAKE_BLOCK(32);
+
+	// statistics are returned also when stopping, before they are dropped
+	command_stats_read(blk, RXA_REF(frm, 2));
+	if (RXA_TYPE(frm, 1) == RXT_LOGIC) command_stats_start(RXA_LOGIC(frm, 1));
+
+	RXA_SERIES(frm, 1) = blk;
+	RXA_TYPE  (frm, 1) = RXT_BLOCK;
+	RXA_INDEX (frm, 1) = 0;
+	return RXR_VALUE;
+}
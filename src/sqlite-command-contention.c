@@ -0,0 +1,49 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Lock contention statistics collected by the busy handler.
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_contention(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+	SQLITE_BUSY_POLICY busy;
+	sqlite3_mutex *mutex;
+	REBSER *blk;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	if (!ctx->db) RETURN_STR_ERROR("[SQLITE] Database is not open!");
+
+	// the statistics are updated while the connection's mutex is held
+	mutex = sqlite3_db_mutex(ctx->db);
+	sqlite3_mutex_enter(mutex);
+	busy = ctx->busy;
+	if (RXA_REF(frm, 2)) { // reset
+		ctx->busy.waits     = 0;
+		ctx->busy.retries   = 0;
+		ctx->busy.failures  = 0;
+		ctx->busy.wait_time = 0;
+		ctx->busy.max_wait  = 0;
+	}
+	sqlite3_mutex_leave(mutex);
+
+	blk = RL_MAKE_BLOCK(10);
+	append_field(blk, "waits",     busy.waits,     RXT_INTEGER);
+	append_field(blk, "retries",   busy.retries,   RXT_INTEGER);
+	append_field(blk, "failures",  busy.failures,  RXT_INTEGER);
+	append_field(blk, "wait-time", busy.wait_time * 1000000, RXT_TIME); // ms to ns
+	append_field(blk, "max-wait",  busy.max_wait  * 1000000, RXT_TIME);
+
+	RXA_SERIES(frm, 1) = blk;
+	RXA_TYPE(frm, 1)   = RXT_BLOCK;
+	RXA_INDEX(frm, 1)  = 0;
+	return RXR_VALUE;
+}
@@ -19,6 +19,7 @@ int bind_parameters(sqlite3_stmt *stmt, REBSER *params, REBCNT *index) {
 	REBSER  *ser;
 	REBCNT   idx = *index;
 	REBOOL   blockData = FALSE;
+	i64      start = (call_flags & TIMING) ? monotonic_ns() : 0;
 
 	rc = 0;
 
@@ -86,6 +87,7 @@ int bind_parameters(sqlite3_stmt *stmt, REBSER *params, REBCNT *index) {
 	}
 	//debug_print("bind rc: %i\n", rc);
 	*index = blockData ? *index+1 : idx;
+	if (start) command_bind_ns += monotonic_ns() - start;
 	return rc;
 }
 
@@ -107,10 +109,12 @@ int cmd_sqlite_eval(RXIFRM* frm, void* reb_ctx) {
 
 	SQLITE_STMT    *ctxStmt = NULL;
 	SQLITE_CONTEXT *ctx;
+	SQLITE_PLANS   *plans;
 	sqlite3        *db   = NULL;
 	sqlite3_stmt   *stmt = NULL;
-	int rc;
+	int rc, id, limit;
 	int ret = RXR_UNSET;
+	SQLITE_MADE made = {0};
 
 	maxRows = (REBCNT)-1; //TODO: it should be user defined
 
@@ -122,6 +126,7 @@ int cmd_sqlite_eval(RXIFRM* frm, void* reb_ctx) {
 	if (RXA_TYPE(frm,2) == RXT_HANDLE) {
 		RESOLVE_SQLITE_STMT(ctxStmt, 2);
 		stmt = ctxStmt->stmt;
+		prefetch_stop(ctxStmt);
 	}
 	else if (RXA_TYPE(frm,2) == RXT_STRING) {
 		// evaluate single or more semicolon separated statemens using the sqlite_exec function
@@ -149,6 +154,11 @@ int cmd_sqlite_eval(RXIFRM* frm, void* reb_ctx) {
 			}
 			ctxStmt = (SQLITE_STMT*)hobStmt->data;
 			stmt = ctxStmt->stmt;
+			if (ctxStmt->busy) {
+				RXA_SERIES(frm, 1) = "[SQLITE] Statement is used by an async query!";
+				return RXR_ERROR;
+			}
+			prefetch_stop(ctxStmt);
 		}
 		else {
 			rc = SQLITE_MISUSE;
@@ -157,6 +167,23 @@ int cmd_sqlite_eval(RXIFRM* frm, void* reb_ctx) {
 		index++;
 	}
 
+	// time limit of this call or of the statement/connection
+	limit = RXA_REF(frm, 4) ? (int)MIN(RXA_INT64(frm, 5), MAX_I32) : deadline_limit(db, ctxStmt);
+
+	if (RXA_REF(frm, 3)) { // async
+		if (!worker_allowed()) {
+			if (freeStmt) sqlite3_finalize(stmt);
+			RXA_SERIES(frm, 1) = "[SQLITE] Async queries require the serialized threading mode!";
+			return RXR_ERROR;
+		}
+		rc = worker_eval(ctx, stmt, ctxStmt, params, index, limit, &id);
+		if (rc != SQLITE_OK) goto finish;
+		// the statement is finalized by the worker
+		RXA_INT64(frm, 1) = id;
+		RXA_TYPE (frm, 1) = RXT_INTEGER;
+		return RXR_VALUE;
+	}
+
 	// bind statement's parameters...
 	if (params) {
 		//if (ctxStmt) debug_print("ctxStmt->last_result_code = %i\n", ctxStmt->last_result_code);
@@ -165,9 +192,13 @@ int cmd_sqlite_eval(RXIFRM* frm, void* reb_ctx) {
 		if (rc != SQLITE_OK) goto finish;
 	}
 
+	// plans of finished runs are made before the schema may change
+	if ((plans = plans_watched(ctx))) plans_check(plans, db);
+
 	// evaluate single statement using the sqlite_step function
+	deadline_start(db, limit);
 	for (row = 0; row < maxRows; row++) {
-		rc = sqlite3_step(stmt);
+		rc = stmt_step(ctxStmt ? &ctxStmt->steps : NULL, stmt);
 		if (ctxStmt) ctxStmt->last_result_code = rc;
 		//debug_print("row: %i = step result: %i, requested rows: %u\n", row, rc, maxRows);
 
@@ -203,6 +234,7 @@ int cmd_sqlite_eval(RXIFRM* frm, void* reb_ctx) {
 							type = RXT_STRING;
 							bytes = sqlite3_column_bytes(stmt, col);
 							arg.series = RL_DECODE_UTF_STRING((REBYTE*)sqlite3_column_text(stmt, col), bytes, 8, 0, 0);
+							series_made(&made, arg.series);
 							break;
 						case SQLITE_BLOB:
 							type = RXT_BINARY;
@@ -213,6 +245,7 @@ int cmd_sqlite_eval(RXIFRM* frm, void* reb_ctx) {
 								memcpy(SERIES_DATA(ser), bin, bytes);
 								SERIES_TAIL(ser) = bytes;
 								arg.series = ser;
+								series_made(&made, ser);
 							}
 							break;
 						case SQLITE_NULL:
@@ -225,7 +258,11 @@ int cmd_sqlite_eval(RXIFRM* frm, void* reb_ctx) {
 				break;
 			case SQLITE_DONE:
 				//trace("step done");
-				if(result) return RXR_VALUE;
+				if(result) {
+					series_made(&made, result);
+					result_made(ctx, ctxStmt, &made);
+					return RXR_VALUE;
+				}
 				ctx->last_insert_count += sqlite3_changes(db);
 				sqlite3_reset(stmt);
 
@@ -252,9 +289,7 @@ finish:
 	if (freeStmt) sqlite3_finalize(stmt);
 	if( rc!=SQLITE_OK ){
 error:
-		snprintf((char*)error_buffer, 254,"[SQLITE] %s", sqlite3_errstr(rc));
-		RXA_SERIES(frm, 1) = (void*)error_buffer;
-		return RXR_ERROR;
+		RETURN_SQLITE_ERROR("[SQLITE] %s", rc == SQLITE_INTERRUPT ? interrupt_message() : sqlite3_errstr(rc));
 	}
 
 	return ret;
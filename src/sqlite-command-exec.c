@@ -47,6 +47,7 @@ int cmd_sqlite_exec(RXIFRM* frm, void* reb_ctx) {
 	REBHOB  *hob;
 	REBSER  *sql;
 	SQLITE_CONTEXT *ctx;
+	SQLITE_PLANS *plans;
 	sqlite3 *db = NULL;
 	int rc;
 
@@ -57,6 +58,9 @@ int cmd_sqlite_exec(RXIFRM* frm, void* reb_ctx) {
 
 	//debug_print("exec  DB: %p\n", (void*)db);
 	//debug_print("exec SQL: %s\n", SERIES_TEXT(sql));
+	// plans of finished runs are made before the schema may change
+	if ((plans = plans_watched(ctx))) plans_check(plans, db);
+	deadline_start(db, ctx->time_limit); // for all the statements together
 	rc = sqlite3_exec(db, SERIES_TEXT(sql), callback, 0, 0);
 
 // Code to collect callback args instead of printing it directly...
@@ -70,10 +74,11 @@ int cmd_sqlite_exec(RXIFRM* frm, void* reb_ctx) {
 
 
 	//debug_print("exec result: %i\n", rc);
+	if( rc==SQLITE_INTERRUPT ){
+		RETURN_SQLITE_ERROR("[SQLITE] %s", interrupt_message());
+	}
 	if( rc!=SQLITE_OK ){
-		snprintf((char*)error_buffer, 254,"[SQLITE] %s %s", sqlite3_errstr(rc), sqlite3_errmsg(db));
-		RXA_SERIES(frm, 1) = (void*)error_buffer;
-		return RXR_ERROR;
+		RETURN_SQLITE_ERROR("[SQLITE] %s %s", sqlite3_errstr(rc), sqlite3_errmsg(db));
 	}
 
 	return RXR_UNSET;
@@ -0,0 +1,191 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+#define MAX_PARTITIONS 64
+
+typedef struct {
+	sqlite3    *db;
+	const char *sql;
+	int         sql_len;
+	i64         low;
+	i64         high;
+	sqlite3_snapshot *snapshot; // NULL = the latest state
+	SQLITE_ROWS rows;
+	size_t      pos;   // merge position
+	int         rc;
+	char       *error; // message of a failed partition (sqlite3_malloc)
+} PARTITION;
+
+static void run_partition(void *data) {
+	PARTITION *part = (PARTITION*)data;
+	sqlite3_stmt *stmt = NULL;
+	int rc = SQLITE_OK;
+
+	if (part->snapshot) rc = snapshot_begin(part->db, part->snapshot);
+	if (rc == SQLITE_OK) rc = sqlite3_prepare_v2(part->db, part->sql, part->sql_len, &stmt, 0);
+	if (rc == SQLITE_OK) {
+		sqlite3_bind_int64(stmt, 1, part->low);
+		sqlite3_bind_int64(stmt, 2, part->high);
+		while (SQLITE_ROW == (rc = sqlite3_step(stmt))) {
+			rc = rows_append(&part->rows, stmt);
+			if (rc != SQLITE_OK) break;
+		}
+		if (rc == SQLITE_DONE) rc = SQLITE_OK;
+	}
+	sqlite3_finalize(stmt);
+	// kept before the transaction is ended
+	if (rc != SQLITE_OK) part->error = sqlite3_mprintf("%s", sqlite3_errmsg(part->db));
+	// the transaction of the first reader is ended by the caller
+	if (part->snapshot && !sqlite3_get_autocommit(part->db)) sqlite3_exec(part->db, "COMMIT", NULL, NULL, NULL);
+	part->rc = rc;
+}
+
+// Takes the rows from sorted partitions in order of the key column
+// (descending when negative). Values are compared by rows_compare, so text
+// uses the BINARY collation; partitions sorted by another one (like NOCASE)
+// are not merged in their order.
+static void merge_partitions(PARTITION *parts, int count, int key, REBSER *blk, SQLITE_MADE *made) {
+	int i, best, desc = key < 0, col = (desc ? -key : key) - 1;
+	const REBYTE *value, *best_value;
+
+	for (;;) {
+		best = -1;
+		best_value = NULL;
+		for (i = 0; i < count; i++) {
+			if (parts[i].pos >= parts[i].rows.used) continue;
+			value = rows_column(&parts[i].rows, parts[i].pos, col);
+			if (best < 0 || (desc ? rows_compare(value, best_value) > 0 : rows_compare(value, best_value) < 0)) {
+				best = i;
+				best_value = value;
+			}
+		}
+		if (best < 0) break;
+		rows_convert(&parts[best].rows, &parts[best].pos, 1, blk, made);
+	}
+}
+
+int cmd_sqlite_fan_out(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	REBSER  *sql;
+	REBSER  *blk;
+	SQLITE_CONTEXT *ctx;
+	SQLITE_THREAD  *threads[MAX_PARTITIONS];
+	PARTITION parts[MAX_PARTITIONS];
+	sqlite3_stmt *stmt;
+	sqlite3_snapshot *snapshot = NULL;
+	SQLITE_MADE made = {0};
+	i64 low, high, bound, total = 0;
+	u64 size;
+	int i, count, key = 0, columns = 0, failed = -1, rc;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	sql   = utf8_string(RXA_ARG(frm, 2));
+	low   = RXA_INT64(frm, 3);
+	high  = RXA_INT64(frm, 4);
+	count = RXA_INT32(frm, 5);
+	if (RXA_REF(frm, 6)) key = RXA_INT32(frm, 7);
+
+	if (!sqlite3_threadsafe() || threading_mode == SQLITE_CONFIG_SINGLETHREAD) {
+		RXA_SERIES(frm, 1) = "[SQLITE] Parallel queries are not available in the single-thread mode!";
+		return RXR_ERROR;
+	}
+	if (count < 1 || count > MAX_PARTITIONS) {
+		RXA_SERIES(frm, 1) = "[SQLITE] Number of partitions must be in range 1-64!";
+		return RXR_ERROR;
+	}
+
+	// validate the query on the main connection first
+	rc = sqlite3_prepare_v2(ctx->db, SERIES_TEXT(sql), SERIES_TAIL(sql), &stmt, 0);
+	if (rc != SQLITE_OK) {
+		RETURN_SQLITE_ERROR("[SQLITE] %s %s", sqlite3_errstr(rc), sqlite3_errmsg(ctx->db));
+	}
+	if (!sqlite3_stmt_readonly(stmt) || sqlite3_bind_parameter_count(stmt) != 2) rc = SQLITE_MISUSE;
+	columns = sqlite3_column_count(stmt);
+	sqlite3_finalize(stmt);
+	if (rc != SQLITE_OK) {
+		RXA_SERIES(frm, 1) = "[SQLITE] Query must be read-only with lower and upper bound parameters!";
+		return RXR_ERROR;
+	}
+	if (key && (key > columns || -key > columns)) {
+		RXA_SERIES(frm, 1) = "[SQLITE] Invalid merge column!";
+		return RXR_ERROR;
+	}
+
+	rc = readers_reserve(ctx, count);
+	if (rc != SQLITE_OK) goto error;
+
+	// All partitions read the same (latest committed) state of a WAL database.
+	// The first reader takes its snapshot and keeps the read transaction until
+	// all are finished, so the WAL is not reset before the others open it. The
+	// main connection is not used, its transaction may be one of the async
+	// worker. Without snapshots each partition reads the latest state.
+	if (SQLITE_OK != sqlite3_exec(ctx->readers[0], "BEGIN", NULL, NULL, NULL)
+	 || SQLITE_OK != snapshot_take(ctx->readers[0], &snapshot)) snapshot = NULL;
+
+	// split [low, high) into `count` ranges of (almost) the same size
+	// (the width of the whole range may not fit into i64)
+	if (high < low) high = low;
+	size = ((u64)high - (u64)low) / count + (((u64)high - (u64)low) % count ? 1 : 0);
+	bound = low;
+	memset(parts, 0, sizeof(parts));
+	for (i = 0; i < count; i++) {
+		parts[i].db      = ctx->readers[i];
+		parts[i].sql     = SERIES_TEXT(sql);
+		parts[i].sql_len = SERIES_TAIL(sql);
+		parts[i].low     = bound;
+		// steps from the previous bound, so it never passes `high`
+		bound = (i < count - 1 && (u64)high - (u64)bound > size) ? (i64)((u64)bound + size) : high;
+		parts[i].high    = bound;
+		parts[i].snapshot = i ? snapshot : NULL; // the first one is in it already
+		threads[i] = thread_start(run_partition, &parts[i]);
+		// evaluate it here, when the thread could not be started
+		if (!threads[i]) run_partition(&parts[i]);
+	}
+	for (i = 0; i < count; i++) {
+		if (threads[i]) thread_join(threads[i]);
+		if (parts[i].rc != SQLITE_OK && failed < 0) failed = i;
+		total += parts[i].rows.count;
+	}
+	if (snapshot) snapshot_free(snapshot);
+	if (!sqlite3_get_autocommit(ctx->readers[0])) sqlite3_exec(ctx->readers[0], "COMMIT", NULL, NULL, NULL);
+
+	if (failed < 0) {
+		blk = RL_MAKE_BLOCK((REBCNT)(total * columns));
+		if (key) merge_partitions(parts, count, key, blk, &made);
+		else {
+			for (i = 0; i < count; i++) rows_convert(&parts[i].rows, &parts[i].pos, -1, blk, &made);
+		}
+		series_made(&made, blk);
+		result_made(ctx, NULL, &made);
+		RXA_SERIES(frm, 1) = blk;
+		RXA_TYPE  (frm, 1) = RXT_BLOCK;
+		RXA_INDEX (frm, 1) = 0;
+	}
+	if (failed >= 0) {
+		snprintf(error_buffer, sizeof(error_buffer), "[SQLITE] %s",
+			parts[failed].error ? parts[failed].error : sqlite3_errstr(parts[failed].rc));
+	}
+	for (i = 0; i < count; i++) {
+		rows_free(&parts[i].rows);
+		sqlite3_free(parts[i].error);
+	}
+	if (failed >= 0) {
+		RXA_SERIES(frm, 1) = (void*)error_buffer;
+		return RXR_ERROR;
+	}
+	return RXR_VALUE;
+
+error:
+	RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(rc));
+}
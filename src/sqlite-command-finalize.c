@@ -17,6 +17,7 @@ int cmd_sqlite_finalize(RXIFRM* frm, void* reb_ctx) {
 	SQLITE_STMT *ctxStmt;
 
 	RESOLVE_SQLITE_STMT(ctxStmt, 1);
+	prefetch_stop(ctxStmt);
 	sqlite3_finalize(ctxStmt->stmt);
 	ctxStmt->stmt = NULL;
 	return RXR_UNSET;
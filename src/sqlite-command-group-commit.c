@@ -0,0 +1,36 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_group_commit(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+	i64 delay, writes;
+	int rc;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	if (!ctx->db) RETURN_STR_ERROR("[SQLITE] Database is not open!");
+	if (!worker_allowed()) {
+		RXA_SERIES(frm, 1) = "[SQLITE] Async queries require the serialized threading mode!";
+		return RXR_ERROR;
+	}
+	delay  = RXA_INT64(frm, 2);
+	writes = RXA_INT64(frm, 3);
+	if (delay < 0 || writes < 1)
+		RETURN_STR_ERROR("[SQLITE] Invalid group commit delay or number of writes!");
+
+	rc = worker_group_commit(ctx, (int)MIN(delay, MAX_I32), (int)MIN(writes, MAX_I32));
+	if (rc != SQLITE_OK)
+		RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(rc));
+	return RXR_TRUE;
+}
@@ -0,0 +1,20 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_hard_heap_limit(RXIFRM* frm, void* reb_ctx) {
+	// negative limit only returns the current value
+	RXA_INT64(frm, 1) = sqlite3_hard_heap_limit64(RXA_INT64(frm, 1));
+	RXA_TYPE (frm, 1) = RXT_INTEGER;
+	return RXR_VALUE;
+}
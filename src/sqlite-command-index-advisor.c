@@ -0,0 +1,31 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_index_advisor(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+	int rc;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	if (!ctx->db) RETURN_STR_ERROR("[SQLITE] Database is not open!");
+
+	if (RXA_TYPE(frm, 2) == RXT_INTEGER) {
+		if (RXA_INT64(frm, 2) < 0) RETURN_STR_ERROR("[SQLITE] Threshold must not be negative!");
+		rc = advisor_start(ctx, TRUE, RXA_INT64(frm, 2));
+	}
+	else rc = advisor_start(ctx, FALSE, 0);
+	if (rc != SQLITE_OK)
+		RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(rc));
+	return RXR_TRUE;
+}
@@ -11,84 +11,143 @@
 // Use on your own risc!
 
 #include "sqlite-rebol-extension.h"
+#include <string.h>
 
+// Rebol series made for results (the reset clears also the peak).
+static void append_result_memory(REBSER *blk, SQLITE_RESULT_MEMORY *memory, int reset) {
+	append_field(blk, "results",       memory->results, RXT_INTEGER);
+	append_field(blk, "result-series", memory->series,  RXT_INTEGER);
+	append_field(blk, "result-bytes",  memory->bytes,   RXT_INTEGER);
+	append_field(blk, "result-peak",   memory->peak,    RXT_INTEGER);
+	if (reset) CLEARS(memory);
+}
 
-int cmd_sqlite_info(RXIFRM* frm, void* reb_ctx) {
-	// return library info...
-	REBI64  tail = 0;
-	REBSER *str  = RL_MAKE_STRING(1000, FALSE); // 1024 bytes, latin1 (must be large enough!)
-	REBYTE rebol_version[8];
+// Runtime counters of the statement, so full scans and sorts can be found.
+static REBSER* stmt_status(SQLITE_STMT *ctx, REBOOL reset) {
+	sqlite3_stmt *stmt = ctx->stmt;
+	REBSER *blk = RL_MAKE_BLOCK(40);
+	SQLITE_STEP_STATS steps;
+
+	// a finished async job publishes its statistics under the worker's lock
+	if (ctx->worker) lock_enter(ctx->worker->lock);
+	steps = ctx->steps;
+	if (reset) CLEARS(&ctx->steps);
+	if (ctx->worker) lock_leave(ctx->worker->lock);
+
+	append_field(blk, "fullscan-steps",  sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, reset), RXT_INTEGER);
+	append_field(blk, "sorts",           sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT,          reset), RXT_INTEGER);
+	append_field(blk, "auto-indexes",    sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX,     reset), RXT_INTEGER);
+	append_field(blk, "vm-steps",        sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP,       reset), RXT_INTEGER);
+	append_field(blk, "reprepares",      sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_REPREPARE,     reset), RXT_INTEGER);
+	append_field(blk, "runs",            sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_RUN,           reset), RXT_INTEGER);
+	append_field(blk, "filter-hits",     sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FILTER_HIT,    reset), RXT_INTEGER);
+	append_field(blk, "filter-misses",   sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FILTER_MISS,   reset), RXT_INTEGER);
+	append_field(blk, "memory",          sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_MEMUSED,       0),     RXT_INTEGER);
+	append_field(blk, "step-time",       steps.time, RXT_TIME);
+	append_field(blk, "rows",            steps.rows, RXT_INTEGER);
+	append_field(blk, "last-result-code", ctx->last_result_code, RXT_INTEGER);
+	append_field(blk, "bind-parameters", sqlite3_bind_parameter_count(stmt), RXT_INTEGER);
+	append_field(blk, "data-count",      sqlite3_data_count(stmt), RXT_INTEGER);
+	append_field(blk, "busy",            ctx->busy, RXT_LOGIC);
+	append_result_memory(blk, &ctx->memory, reset);
+	return blk;
+}
 
 
+static void append_db_status(REBSER *blk, sqlite3 *db, const char *name, const char *max, int op, int reset) {
+	int value = 0, highwater = 0;
+	sqlite3_db_status(db, op, &value, &highwater, reset);
+	if (name) append_field(blk, name, value, RXT_INTEGER);
+	if (max)  append_field(blk, max, highwater, RXT_INTEGER);
+}
+
+// Counters of the connection (the reset clears hits, misses and high-water marks).
+static REBSER* db_status(SQLITE_CONTEXT *ctx, int reset) {
+	sqlite3 *db = ctx->db;
+	const char *file = sqlite3_db_filename(db, "main");
+	REBSER *blk = RL_MAKE_BLOCK(48);
+
+	append_text (blk, "file", file ? file : "");
+	append_field(blk, "read-only",  sqlite3_db_readonly(db, "main") == 1, RXT_LOGIC);
+	append_field(blk, "autocommit", sqlite3_get_autocommit(db), RXT_LOGIC);
+	append_db_status(blk, db, "cache-used",        NULL, SQLITE_DBSTATUS_CACHE_USED,        0);
+	append_db_status(blk, db, "cache-used-shared", NULL, SQLITE_DBSTATUS_CACHE_USED_SHARED, 0);
+	append_db_status(blk, db, "cache-hits",        NULL, SQLITE_DBSTATUS_CACHE_HIT,         reset);
+	append_db_status(blk, db, "cache-misses",      NULL, SQLITE_DBSTATUS_CACHE_MISS,        reset);
+	append_db_status(blk, db, "cache-writes",      NULL, SQLITE_DBSTATUS_CACHE_WRITE,       reset);
+	append_db_status(blk, db, "cache-spills",      NULL, SQLITE_DBSTATUS_CACHE_SPILL,       reset);
+	append_db_status(blk, db, "lookaside-used", "lookaside-used-max", SQLITE_DBSTATUS_LOOKASIDE_USED, reset);
+	append_db_status(blk, db, NULL, "lookaside-hits",      SQLITE_DBSTATUS_LOOKASIDE_HIT,       reset);
+	append_db_status(blk, db, NULL, "lookaside-miss-size", SQLITE_DBSTATUS_LOOKASIDE_MISS_SIZE, reset);
+	append_db_status(blk, db, NULL, "lookaside-miss-full", SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL, reset);
+	append_db_status(blk, db, "schema-memory",    NULL, SQLITE_DBSTATUS_SCHEMA_USED, 0);
+	append_db_status(blk, db, "statement-memory", NULL, SQLITE_DBSTATUS_STMT_USED,   0);
+	append_db_status(blk, db, "deferred-fks",     NULL, SQLITE_DBSTATUS_DEFERRED_FKS, 0);
+	append_result_memory(blk, &ctx->memory, reset);
+	return blk;
+}
+
+static void append_status(REBSER *blk, const char *name, const char *max, int op, int reset) {
+	sqlite3_int64 value = 0, highwater = 0;
+	sqlite3_status64(op, &value, &highwater, reset);
+	if (name) append_field(blk, name, value, RXT_INTEGER);
+	if (max)  append_field(blk, max, highwater, RXT_INTEGER);
+}
+
+// Versions and global memory statistics (the reset clears high-water marks).
+static REBSER* library_status(int reset) {
+	REBSER *blk = RL_MAKE_BLOCK(48);
+	REBYTE ver[8];
+	char buf[32];
+
+	RL_VERSION(ver);
+	snprintf(buf, sizeof(buf), "%u.%u.%u", MIN_REBOL_VER, MIN_REBOL_REV, MIN_REBOL_UPD);
+	append_text(blk, "rebol-needed", buf);
+	snprintf(buf, sizeof(buf), "%u.%u.%u", ver[1], ver[2], ver[3]);
+	append_text(blk, "rebol-current", buf);
+	append_text(blk, "version", sqlite3_libversion());
+	append_text(blk, "threads",
+		!sqlite3_threadsafe() ? "none (compiled single-thread)"
+		: threading_mode == SQLITE_CONFIG_SINGLETHREAD ? "single-thread"
+		: threading_mode == SQLITE_CONFIG_MULTITHREAD  ? "multi-thread"
+		: "serialized"
+	);
+	append_field(blk, "threadsafe", sqlite3_threadsafe() != 0, RXT_LOGIC);
+	// the memory used is outstanding bytes (malloced but not freed)
+	append_status(blk, "memory-used", "memory-max", SQLITE_STATUS_MEMORY_USED, reset);
+	append_status(blk, "malloc-count", "malloc-count-max", SQLITE_STATUS_MALLOC_COUNT, reset);
+	append_status(blk, NULL, "malloc-size-max", SQLITE_STATUS_MALLOC_SIZE, reset);
+	append_status(blk, "page-cache-used", "page-cache-used-max", SQLITE_STATUS_PAGECACHE_USED, reset);
+	append_status(blk, "page-cache-overflow", "page-cache-overflow-max", SQLITE_STATUS_PAGECACHE_OVERFLOW, reset);
+	append_status(blk, NULL, "page-cache-size-max", SQLITE_STATUS_PAGECACHE_SIZE, reset);
+	append_status(blk, NULL, "parser-stack-max", SQLITE_STATUS_PARSER_STACK, reset);
+	return blk;
+}
+
+int cmd_sqlite_info(RXIFRM* frm, void* reb_ctx) {
+	REBSER *blk = NULL;
+	int reset = RXA_REF(frm, 3);
+
 	if (RXT_HANDLE == RXA_TYPE(frm, 2)) {
 		// Info about given handle...
 		REBHOB* hob = RXA_HANDLE(frm, 2);
-		//debug_print("hob: %p\n", hob);
 
 		if (hob->sym == Handle_SQLiteDB) {
 			SQLITE_CONTEXT* ctx = (SQLITE_CONTEXT*)hob->data;
-			//debug_print("ctx: %p\n", ctx);
-			if(!ctx) return RXR_NONE;
-			tail = snprintf(
-				SERIES_TEXT(str),
-				SERIES_REST(str),
-				"sqlite-ctx-Ptr: <%p>\n"
-				"sqlite-ctx-DB:  <%p>\n"
-				"sqlite-buffer-size: %i\n",
-				(void*)ctx,
-				ctx->db,
-				(ctx->buf ? SERIES_REST(ctx->buf) : 0)
-			);
+			if(!ctx || !ctx->db) return RXR_NONE;
+			blk = db_status(ctx, reset);
 		}
 		else if (hob->sym == Handle_SQLiteSTMT) {
 			SQLITE_STMT* ctx = (SQLITE_STMT*)hob->data;
-			//debug_print("ctx: %p\n", ctx);
-			if(!ctx) return RXR_NONE;
-			tail = snprintf(
-				SERIES_TEXT(str),
-				SERIES_REST(str),
-				"sqlite-stmt-Ptr:  <%p>\n"
-				"sqlite-stmt:      <%p>\n"
-				"last-result-code:  %i\n"
-				"bind-parameters:   %i\n"
-				"data-count:        %i\n",
-				(void*)ctx,
-				ctx->stmt,
-				ctx->last_result_code,
-				(ctx->stmt ? sqlite3_bind_parameter_count(ctx->stmt) : 0),
-				sqlite3_data_count(ctx->stmt)
-			);
-		}
-		else {
-			// unsupported handle
+			if(!ctx || !ctx->stmt) return RXR_NONE;
+			blk = stmt_status(ctx, reset);
 		}
+		else return RXR_NONE; // unsupported handle
 	}
-	else {
-		// Some system info...
-		RL_VERSION(rebol_version);
-
-		tail = snprintf(
-			SERIES_TEXT(str),
-			SERIES_REST(str),
-			"\n"
-			"Rebol-needed:   %u.%u.%u\n"
-			"Rebol-current:  %u.%u.%u\n"
-			"SQLite-version: %s\n"
-			"SQLite-memory:  %llu\n" // the number of bytes of memory currently outstanding (malloced but not freed)
-			"SQLite-mem-top: %llu\n",
-			MIN_REBOL_VER, MIN_REBOL_REV, MIN_REBOL_UPD,
-			rebol_version[1], rebol_version[2], rebol_version[3],
-			sqlite3_libversion(),
-			sqlite3_memory_used(),
-			sqlite3_memory_highwater(0)
-		);
-	}
-	if (tail < 0) return RXR_NONE;
-	else {
-		SERIES_TAIL(str) = tail;
-		RXA_SERIES(frm, 1) = str;
-		RXA_TYPE(frm, 1) = RXT_STRING;
-		RXA_INDEX(frm, 1) = 0;
-	}
+	else blk = library_status(reset);
+
+	RXA_SERIES(frm, 1) = blk;
+	RXA_TYPE(frm, 1) = RXT_BLOCK;
+	RXA_INDEX(frm, 1) = 0;
 	return RXR_VALUE;
 }
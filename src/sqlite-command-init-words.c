@@ -0,0 +1,19 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_init_words(RXIFRM* frm, void* reb_ctx) {
+	words_sqlite_cmd = RL_MAP_WORDS(RXA_SERIES(frm, 1));
+	words_sqlite_arg = RL_MAP_WORDS(RXA_SERIES(frm, 2));
+	return RXR_TRUE;
+}
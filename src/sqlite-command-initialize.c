@@ -12,12 +12,84 @@
 
 #include "sqlite-rebol-extension.h"
 
+static int get_integer(REBSER *cfg, REBCNT index, int *result) {
+	RXIARG arg;
+	if (RXT_INTEGER != RL_GET_VALUE_RESOLVED(cfg, index, &arg)) return FALSE;
+	*result = (int)arg.int64;
+	return TRUE;
+}
+
+static int get_logic(REBSER *cfg, REBCNT index, int *result) {
+	RXIARG arg;
+	if (RXT_LOGIC != RL_GET_VALUE_RESOLVED(cfg, index, &arg)) return FALSE;
+	*result = arg.int32a;
+	return TRUE;
+}
+
+// Applies the configuration dialect, for example:
+// [threading multi-thread memstatus off page-cache 4096 500 lookaside 128 64 allocator pool]
+static int configure(REBSER *cfg, REBCNT index) {
+	REBCNT word;
+	int rc = SQLITE_OK, a, b;
+
+	while (rc == SQLITE_OK && index < SERIES_TAIL(cfg)) {
+		if (!fetch_word(cfg, index++, words_sqlite_arg, &word)) return SQLITE_MISUSE;
+		switch (word) {
+		case W_ARG_MEMSTATUS:
+			if (!get_logic(cfg, index++, &a)) return SQLITE_MISUSE;
+			rc = sqlite3_config(SQLITE_CONFIG_MEMSTATUS, a);
+			break;
+		case W_ARG_PAGE_CACHE:
+			if (!get_integer(cfg, index++, &a) || !get_integer(cfg, index++, &b)) return SQLITE_MISUSE;
+			rc = configure_page_cache(a, b);
+			break;
+		case W_ARG_LOOKASIDE:
+			if (!get_integer(cfg, index++, &a) || !get_integer(cfg, index++, &b)) return SQLITE_MISUSE;
+			rc = sqlite3_config(SQLITE_CONFIG_LOOKASIDE, a, b);
+			break;
+		case W_ARG_THREADING:
+			if (!fetch_word(cfg, index++, words_sqlite_arg, &word)) return SQLITE_MISUSE;
+			switch (word) {
+				case W_ARG_SINGLE_THREAD: a = SQLITE_CONFIG_SINGLETHREAD; break;
+				case W_ARG_MULTI_THREAD:  a = SQLITE_CONFIG_MULTITHREAD;  break;
+				case W_ARG_SERIALIZED:    a = SQLITE_CONFIG_SERIALIZED;   break;
+				default: return SQLITE_MISUSE;
+			}
+			// fails with SQLITE_ERROR when compiled with SQLITE_THREADSAFE=0
+			rc = sqlite3_config(a);
+			if (rc == SQLITE_OK) threading_mode = a;
+			break;
+		case W_ARG_ALLOCATOR:
+			if (!fetch_word(cfg, index++, words_sqlite_arg, &word)) return SQLITE_MISUSE;
+			if (word == W_ARG_POOL)
+				rc = configure_pool_allocator();
+			else if (word == W_ARG_SYSTEM)
+				rc = configure_system_allocator();
+			else return SQLITE_MISUSE;
+			break;
+		default:
+			return SQLITE_MISUSE;
+		}
+	}
+	return rc;
+}
+
 int cmd_sqlite_initialize(RXIFRM* frm, void* reb_ctx) {
-	int rc  = sqlite3_initialize();
-	if (rc != SQLITE_OK) {
-		snprintf((char*)error_buffer, 254,"[SQLITE] %s", sqlite3_errstr(rc));
-		RXA_SERIES(frm, 1) = (void*)error_buffer;
-		return RXR_ERROR;
+	int rc;
+
+	if (RXA_REF(frm, 1)) { // with
+		rc = configure(RXA_SERIES(frm, 2), RXA_INDEX(frm, 2));
+		if (rc == SQLITE_MISUSE) {
+			// sqlite3_config is also refused when the library is already initialized
+			RXA_SERIES(frm, 1) = "[SQLITE] Invalid configuration or library not shut down!";
+			return RXR_ERROR;
+		}
+		if (rc != SQLITE_OK) goto error;
 	}
+	rc = sqlite3_initialize();
+	if (rc != SQLITE_OK) goto error;
 	return RXR_TRUE;
+
+error:
+	RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(rc));
 }
@@ -0,0 +1,24 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_interrupt(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	// safe to be used while a query is evaluated by another thread,
+	// which then fails with the "Query interrupted!" error
+	if (ctx->db) sqlite3_interrupt(ctx->db);
+	return RXR_UNSET;
+}
@@ -16,7 +16,8 @@ int cmd_sqlite_open(RXIFRM* frm, void* reb_ctx) {
 	REBSER  *filename;
 	REBHOB  *hob;
 	SQLITE_CONTEXT *ctx;
-	int rc;
+	const char *vfs = NULL;
+	int rc, flags;
 
 	filename = utf8_string(RXA_ARG(frm, 1));
 
@@ -32,8 +33,21 @@ int cmd_sqlite_open(RXIFRM* frm, void* reb_ctx) {
 	rc = sqlite3_auto_extension((void(*)(void))sqlite3_vec_init);
 	if(rc != SQLITE_OK) goto error;
 
-	rc = sqlite3_open(SERIES_TEXT(filename), &ctx->db);
+	if (RXA_REF(frm, 2)) { // compressed
+		vfs = register_compressed_vfs();
+		if (!vfs) {
+			rc = SQLITE_ERROR;
+			goto error;
+		}
+	}
+
+	flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+	if (RXA_REF(frm, 3)) flags |= SQLITE_OPEN_SHAREDCACHE; // shared
+	rc = sqlite3_open_v2(SERIES_TEXT(filename), &ctx->db, flags, vfs);
 	if(rc != SQLITE_OK) goto error;
+	ctx->vfs = vfs; // static name, also used by the read connections
+	// used to find the connection's worker from its statements
+	sqlite3_set_clientdata(ctx->db, SQLITE_CTX_KEY, ctx, NULL);
 
 	RXA_HANDLE(frm, 1) = hob;
 	RXA_HANDLE_TYPE(frm, 1) = hob->sym;
@@ -43,8 +57,6 @@ int cmd_sqlite_open(RXIFRM* frm, void* reb_ctx) {
 	return RXR_VALUE;
 
 error:
-	snprintf((char*)error_buffer, 254,"[SQLITE] %s", sqlite3_errstr(rc));
-	RXA_SERIES(frm, 1) = (void*)error_buffer;
-	return RXR_ERROR;
+	RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(rc));
 
 }
@@ -0,0 +1,30 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_plan_changes(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+	SQLITE_PLANS *plans;
+	REBSER *blk;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	if (!ctx->db) RETURN_STR_ERROR("[SQLITE] Database is not open!");
+
+	blk = RL_MAKE_BLOCK(8);
+	if ((plans = plans_watched(ctx))) plans_drain(plans, ctx->db, blk);
+	RXA_SERIES(frm, 1) = blk;
+	RXA_TYPE  (frm, 1) = RXT_BLOCK;
+	RXA_INDEX (frm, 1) = 0;
+	return RXR_VALUE;
+}
@@ -0,0 +1,47 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_plan_watch(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+	SQLITE_PLANS *plans;
+	REBSER *blk;
+	int rc = SQLITE_OK;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	if (!ctx->db) RETURN_STR_ERROR("[SQLITE] Database is not open!");
+
+	blk = RL_MAKE_BLOCK(16);
+	// plans are returned also when stopping, before they are dropped
+	if ((plans = plans_watched(ctx))) plans_read(plans, ctx->db, blk);
+	switch (RXA_TYPE(frm, 2)) {
+	case RXT_LOGIC:
+		rc = plans_watch(ctx, RXA_LOGIC(frm, 2));
+		break;
+	case RXT_BLOCK:
+		rc = plans_watch(ctx, TRUE);
+		if (rc == SQLITE_OK)
+			rc = plans_load(plans_watched(ctx), sqlite3_db_mutex(ctx->db), RXA_SERIES(frm, 2), RXA_INDEX(frm, 2));
+		if (rc == SQLITE_MISUSE)
+			RETURN_STR_ERROR("[SQLITE] Plans must be pairs of strings: fingerprint and plan!");
+		break;
+	}
+	if (rc != SQLITE_OK)
+		RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(rc));
+
+	RXA_SERIES(frm, 1) = blk;
+	RXA_TYPE  (frm, 1) = RXT_BLOCK;
+	RXA_INDEX (frm, 1) = 0;
+	return RXR_VALUE;
+}
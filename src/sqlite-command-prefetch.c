@@ -0,0 +1,36 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_prefetch(RXIFRM* frm, void* reb_ctx) {
+	REBHOB      *hobStmt;
+	SQLITE_STMT *ctxStmt;
+	i64 size;
+
+	RESOLVE_SQLITE_STMT(ctxStmt, 1);
+	size = RXA_INT64(frm, 2);
+	if (size > 0) {
+		if (!sqlite3_stmt_readonly(ctxStmt->stmt)) {
+			RXA_SERIES(frm, 1) = "[SQLITE] Only read-only statements may be prefetched!";
+			return RXR_ERROR;
+		}
+		if (!worker_allowed()) {
+			RXA_SERIES(frm, 1) = "[SQLITE] Prefetch requires the serialized threading mode!";
+			return RXR_ERROR;
+		}
+	}
+	// the helper thread is started by the next step
+	prefetch_stop(ctxStmt);
+	ctxStmt->prefetch_size = (size > 0) ? (int)MIN(size, 100000) : 0;
+	return RXR_UNSET;
+}
@@ -38,9 +38,7 @@ int cmd_sqlite_prepare(RXIFRM* frm, void* reb_ctx) {
 	//debug_print("prep result: %i\n", rc);
 	//debug_print("tail: %s\n", zTail);
 	if( rc!=SQLITE_OK ){
-		snprintf((char*)error_buffer, 254,"[SQLITE] %s %s", sqlite3_errstr(rc), sqlite3_errmsg(db));
-		RXA_SERIES(frm, 1) = (void*)error_buffer;
-		return RXR_ERROR;
+		RETURN_SQLITE_ERROR("[SQLITE] %s %s", sqlite3_errstr(rc), sqlite3_errmsg(db));
 	}
 
 	ctxStmt->last_result_code = SQLITE_ROW;
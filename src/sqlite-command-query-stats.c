@@ -0,0 +1,36 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_query_stats(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+	REBSER *blk;
+	int rc;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	if (!ctx->db) RETURN_STR_ERROR("[SQLITE] Database is not open!");
+
+	blk = RL_MAKE_BLOCK(16);
+	// statistics are returned also when stopping, before they are dropped
+	query_stats_read(ctx, blk, RXA_REF(frm, 3));
+	if (RXA_TYPE(frm, 2) == RXT_LOGIC) {
+		rc = query_stats_start(ctx, RXA_LOGIC(frm, 2));
+		if (rc != SQLITE_OK)
+			RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(rc));
+	}
+	RXA_SERIES(frm, 1) = blk;
+	RXA_TYPE  (frm, 1) = RXT_BLOCK;
+	RXA_INDEX (frm, 1) = 0;
+	return RXR_VALUE;
+}
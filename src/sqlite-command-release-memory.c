@@ -0,0 +1,44 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_release_memory(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+	i64 used = sqlite3_memory_used();
+
+	if (RXA_TYPE(frm, 1) == RXT_HANDLE) {
+		if (RXA_REF(frm, 2)) { // auto
+			RXA_SERIES(frm, 1) = "[SQLITE] Only global release may be done on recycle!";
+			return RXR_ERROR;
+		}
+		RESOLVE_SQLITE_CTX(ctx, 1);
+		if (ctx->db) sqlite3_db_release_memory(ctx->db);
+	}
+	else if (RXA_REF(frm, 2)) { // auto
+		release_on_recycle = (int)RXA_INT64(frm, 1);
+		if (release_on_recycle) {
+			call_flags |= CALL_RECYCLE;
+			arm_gc_sentinel();
+		}
+		else call_flags &= ~CALL_RECYCLE;
+		return RXR_UNSET;
+	}
+	else {
+		sqlite3_release_memory((int)RXA_INT64(frm, 1));
+	}
+	// number of released bytes (known only with memstatus enabled)
+	RXA_INT64(frm, 1) = used - sqlite3_memory_used();
+	RXA_TYPE (frm, 1) = RXT_INTEGER;
+	return RXR_VALUE;
+}
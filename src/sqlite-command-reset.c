@@ -17,6 +17,7 @@ int cmd_sqlite_reset(RXIFRM* frm, void* reb_ctx) {
 	SQLITE_STMT *ctxStmt;
 
 	RESOLVE_SQLITE_STMT(ctxStmt, 1);
+	prefetch_stop(ctxStmt);
 	sqlite3_reset(ctxStmt->stmt);
 	ctxStmt->last_result_code = SQLITE_ROW;
 	
@@ -0,0 +1,52 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_result(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+	SQLITE_JOB *job;
+	REBOOL late = FALSE;
+	SQLITE_MADE made = {0};
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	if (!ctx->worker) return RXR_NONE;
+	job = worker_take(ctx->worker, RXA_REF(frm, 2) ? (int)MAX(0, MIN(RXA_INT64(frm, 3), MAX_I32)) : 0, &late);
+	if (!job) {
+		if (late) RETURN_STR_ERROR("[SQLITE] Async query timed out!");
+		return RXR_NONE;
+	}
+
+	if (job->rc != SQLITE_OK) {
+		// the message is owned by the job
+		snprintf(error_buffer, sizeof(error_buffer), "[SQLITE] %s", job->error);
+		job_free(job);
+		RXA_SERIES(frm, 1) = (void*)error_buffer;
+		return RXR_ERROR;
+	}
+	// a step without rows gives an empty block, so none means no finished query
+	if (job->rows.count || job->step) {
+		RXA_SERIES(frm, 1) = rows_to_block(&job->rows, &made);
+		// the statement handle may be already released, only the connection is accounted
+		result_made(ctx, NULL, &made);
+		RXA_TYPE  (frm, 1) = RXT_BLOCK;
+		RXA_INDEX (frm, 1) = 0;
+	}
+	else {
+		ctx->last_insert_count = (int)job->changes;
+		RXA_INT64(frm, 1) = job->changes;
+		RXA_TYPE (frm, 1) = RXT_INTEGER;
+	}
+	job_free(job);
+	return RXR_VALUE;
+}
@@ -0,0 +1,75 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+#ifdef SQLITE_ENABLE_STMT_SCANSTATUS
+// Appends a block for each element of the query plan (with SQLITE_SCANSTAT_COMPLEX
+// also sorts, subqueries and others, which have no loop counters).
+static void scan_status(sqlite3_stmt *stmt, REBSER *result) {
+	REBSER *blk;
+	RXIARG arg;
+	sqlite3_int64 loops, rows, cycles;
+	double estimated;
+	int id, parent, idx;
+	const char *name, *explain;
+
+	for (idx = 0; ; idx++) {
+		if (sqlite3_stmt_scanstatus_v2(stmt, idx, SQLITE_SCANSTAT_SELECTID, SQLITE_SCANSTAT_COMPLEX, &id)) break;
+		sqlite3_stmt_scanstatus_v2(stmt, idx, SQLITE_SCANSTAT_PARENTID, SQLITE_SCANSTAT_COMPLEX, &parent);
+		sqlite3_stmt_scanstatus_v2(stmt, idx, SQLITE_SCANSTAT_NAME,     SQLITE_SCANSTAT_COMPLEX, &name);
+		sqlite3_stmt_scanstatus_v2(stmt, idx, SQLITE_SCANSTAT_EXPLAIN,  SQLITE_SCANSTAT_COMPLEX, &explain);
+		sqlite3_stmt_scanstatus_v2(stmt, idx, SQLITE_SCANSTAT_NLOOP,    SQLITE_SCANSTAT_COMPLEX, &loops);
+		sqlite3_stmt_scanstatus_v2(stmt, idx, SQLITE_SCANSTAT_NVISIT,   SQLITE_SCANSTAT_COMPLEX, &rows);
+		sqlite3_stmt_scanstatus_v2(stmt, idx, SQLITE_SCANSTAT_EST,      SQLITE_SCANSTAT_COMPLEX, &estimated);
+		sqlite3_stmt_scanstatus_v2(stmt, idx, SQLITE_SCANSTAT_NCYCLE,   SQLITE_SCANSTAT_COMPLEX, &cycles);
+
+		blk = RL_MAKE_BLOCK(16);
+		append_field(blk, "id",      id,     RXT_INTEGER);
+		append_field(blk, "parent",  parent, RXT_INTEGER);
+		append_text (blk, "name",    name);
+		append_text (blk, "explain", explain);
+		// counters are negative for elements which are not loops
+		append_field(blk, "loops",   loops, loops < 0 ? RXT_NONE : RXT_INTEGER);
+		append_field(blk, "rows",    rows,  rows  < 0 ? RXT_NONE : RXT_INTEGER);
+		arg.int32a = AS_WORD("estimated");
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_SET_WORD);
+		arg.dec64 = estimated;
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, estimated < 0 ? RXT_NONE : RXT_DECIMAL);
+		append_field(blk, "cycles",  cycles, RXT_INTEGER);
+
+		arg.series = blk;
+		arg.index  = 0;
+		RL_SET_VALUE(result, SERIES_TAIL(result), arg, RXT_BLOCK);
+	}
+}
+#endif
+
+int cmd_sqlite_scan_status(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hobStmt;
+	SQLITE_STMT *ctxStmt;
+	REBSER *blk;
+
+	RESOLVE_SQLITE_STMT(ctxStmt, 1);
+#ifndef SQLITE_ENABLE_STMT_SCANSTATUS
+	RETURN_STR_ERROR("[SQLITE] Scan status is not enabled in this build!");
+#else
+	blk = RL_MAKE_BLOCK(8);
+	scan_status(ctxStmt->stmt, blk);
+	if (RXA_REF(frm, 2)) sqlite3_stmt_scanstatus_reset(ctxStmt->stmt);
+
+	RXA_SERIES(frm, 1) = blk;
+	RXA_TYPE  (frm, 1) = RXT_BLOCK;
+	RXA_INDEX (frm, 1) = 0;
+	return RXR_VALUE;
+#endif
+}
@@ -15,9 +15,7 @@
 int cmd_sqlite_shutdown(RXIFRM* frm, void* reb_ctx) {
 	int rc  = sqlite3_shutdown();
 	if (rc != SQLITE_OK) {
-		snprintf((char*)error_buffer, 254,"[SQLITE] %s", sqlite3_errstr(rc));
-		RXA_SERIES(frm, 1) = (void*)error_buffer;
-		return RXR_ERROR;
+		RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(rc));
 	}
 	return RXR_TRUE;
 }
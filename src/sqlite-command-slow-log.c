@@ -0,0 +1,38 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_slow_log(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	SQLITE_CONTEXT *ctx;
+	REBSER *blk;
+	i64 ms;
+	int rc;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	if (!ctx->db) RETURN_STR_ERROR("[SQLITE] Database is not open!");
+
+	if (RXA_TYPE(frm, 2) == RXT_INTEGER) {
+		ms = RXA_INT64(frm, 2);
+		if (ms < 0) RETURN_STR_ERROR("[SQLITE] Threshold must not be negative!");
+		rc = slow_log_start(ctx, ms);
+		if (rc != SQLITE_OK)
+			RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(rc));
+	}
+	blk = RL_MAKE_BLOCK(8);
+	slow_log_drain(ctx, blk);
+	RXA_SERIES(frm, 1) = blk;
+	RXA_TYPE  (frm, 1) = RXT_BLOCK;
+	RXA_INDEX (frm, 1) = 0;
+	return RXR_VALUE;
+}
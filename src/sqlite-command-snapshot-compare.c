@@ -0,0 +1,25 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_snapshot_compare(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hobSnap;
+	SQLITE_SNAPSHOT *a, *b;
+
+	RESOLVE_SQLITE_SNAPSHOT(a, 1);
+	RESOLVE_SQLITE_SNAPSHOT(b, 2);
+	// the result is meaningful only for snapshots of the same database file
+	RXA_INT64(frm, 1) = snapshot_compare(a->snapshot, b->snapshot);
+	RXA_TYPE (frm, 1) = RXT_INTEGER;
+	return RXR_VALUE;
+}
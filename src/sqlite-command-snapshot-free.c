@@ -0,0 +1,23 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_snapshot_free(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hobSnap;
+	SQLITE_SNAPSHOT *snap;
+
+	RESOLVE_SQLITE_SNAPSHOT(snap, 1);
+	snapshot_free(snap->snapshot);
+	snap->snapshot = NULL;
+	return RXR_UNSET;
+}
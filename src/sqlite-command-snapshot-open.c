@@ -0,0 +1,33 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_snapshot_open(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	REBHOB  *hobSnap;
+	SQLITE_CONTEXT *ctx;
+	SQLITE_SNAPSHOT *snap;
+	int rc;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	RESOLVE_SQLITE_SNAPSHOT(snap, 2);
+	if (!ctx->db) RETURN_STR_ERROR("[SQLITE] Database is not open!");
+
+	// the read transaction is ended by COMMIT (or ROLLBACK) as any other one
+	rc = snapshot_begin(ctx->db, snap->snapshot);
+	if (rc != SQLITE_OK) {
+		// SQLITE_ERROR_SNAPSHOT when the WAL was checkpointed past the snapshot
+		RETURN_SQLITE_ERROR("[SQLITE] %s %s", sqlite3_errstr(rc), sqlite3_errmsg(ctx->db));
+	}
+	return RXR_TRUE;
+}
@@ -0,0 +1,46 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_snapshot(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	REBHOB  *hobSnap;
+	SQLITE_CONTEXT *ctx;
+	SQLITE_SNAPSHOT *snap;
+	sqlite3_snapshot *snapshot = NULL;
+	int rc;
+
+	RESOLVE_SQLITE_CTX(ctx, 1);
+	if (!ctx->db) RETURN_STR_ERROR("[SQLITE] Database is not open!");
+#ifndef SQLITE_ENABLE_SNAPSHOT
+	RETURN_STR_ERROR("[SQLITE] Snapshots are not enabled in this build!");
+#endif
+	rc = snapshot_take(ctx->db, &snapshot);
+	if (rc != SQLITE_OK) {
+		// fails also when the database is not in the WAL mode, or no transaction
+		// was written to its WAL file yet
+		RETURN_SQLITE_ERROR("[SQLITE] %s %s", sqlite3_errstr(rc), sqlite3_errmsg(ctx->db));
+	}
+	hobSnap = RL_MAKE_HANDLE_CONTEXT(Handle_SQLiteSNAPSHOT);
+	if (!hobSnap) {
+		snapshot_free(snapshot);
+		RETURN_STR_ERROR("[SQLITE] Failed to make the snapshot handle!");
+	}
+	snap = (SQLITE_SNAPSHOT*)hobSnap->data;
+	snap->snapshot = snapshot;
+
+	RXA_HANDLE(frm, 1) = hobSnap;
+	RXA_HANDLE_TYPE(frm, 1) = hobSnap->sym;
+	RXA_HANDLE_FLAGS(frm, 1) = hobSnap->flags;
+	return RXR_VALUE;
+}
@@ -20,11 +20,13 @@ int cmd_sqlite_step(RXIFRM* frm, void* reb_ctx) {
 	REBYTE  *bin;
 	RXIARG   arg = {0};
 	SQLITE_STMT *ctxStmt;
+	SQLITE_CONTEXT *ctx;
 	sqlite3_stmt *stmt;
 	char *zErrMsg = 0;
-	int rc, columns, bytes, row, col, type;
-	int refRows, allRows = 0;
-	i64 maxRows, rows;
+	int rc, columns = 0, bytes, row, col, type;
+	int refRows, allRows = 0, id;
+	i64 maxRows, rows, start;
+	SQLITE_MADE made = {0};
 
 	RESOLVE_SQLITE_STMT(ctxStmt, 1);
 	refRows = RXA_REF(frm, 2);
@@ -35,8 +37,25 @@ int cmd_sqlite_step(RXIFRM* frm, void* reb_ctx) {
 
 	stmt = ctxStmt->stmt;
 
+	if (RXA_REF(frm, 6)) { // async
+		if (!worker_allowed()) {
+			RXA_SERIES(frm, 1) = "[SQLITE] Async queries require the serialized threading mode!";
+			return RXR_ERROR;
+		}
+		prefetch_stop(ctxStmt);
+		rc = worker_step(ctxStmt, allRows ? 0 : maxRows, RXA_REF(frm, 4) ? RXA_SERIES(frm, 5) : NULL, &id);
+		if (rc != SQLITE_OK) {
+			RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(rc));
+		}
+		RXA_INT64(frm, 1) = id;
+		RXA_TYPE (frm, 1) = RXT_INTEGER;
+		return RXR_VALUE;
+	}
+
 	if (RXA_REF(frm, 4)) { // with
 		ser = RXA_SERIES(frm, 5);
+		prefetch_stop(ctxStmt); // rows fetched with the old parameters are dropped
+		start = (call_flags & TIMING) ? monotonic_ns() : 0;
 
 		//sqlite3_reset() does not reset the bindings on a prepared statement!
 		sqlite3_clear_bindings(stmt);
@@ -91,12 +110,37 @@ int cmd_sqlite_step(RXIFRM* frm, void* reb_ctx) {
 			}
 			//debug_print("bind result: %i\n", rc);
 		}
+		if (start) command_bind_ns += monotonic_ns() - start;
+	}
+
+	// the connection is unknown for internal ones
+	ctx    = sqlite3_get_clientdata(sqlite3_db_handle(stmt), SQLITE_CTX_KEY);
+
+	if (ctxStmt->prefetch_size && ctxStmt->last_result_code == SQLITE_ROW) {
+		// only converts rows stepped by the helper thread
+		rc = prefetch_step(ctxStmt, allRows ? 0 : maxRows, &blk, &made);
+		ctxStmt->last_result_code = rc;
+		if (rc == SQLITE_ROW || rc == SQLITE_DONE) {
+			if (!blk) {
+				sqlite3_reset(stmt);
+				return RXR_NONE;
+			}
+			series_made(&made, blk);
+			result_made(ctx, ctxStmt, &made);
+			RXA_SERIES(frm, 1) = blk;
+			RXA_TYPE  (frm, 1) = RXT_BLOCK;
+			RXA_INDEX (frm, 1) = 0;
+			return RXR_VALUE;
+		}
+		col = sqlite3_reset(stmt);
+		RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(col == SQLITE_OK ? rc : col));
 	}
 
 	rc = sqlite3_stmt_readonly(stmt) ? ctxStmt->last_result_code : SQLITE_ROW;
+	deadline_start(sqlite3_db_handle(stmt), deadline_limit(sqlite3_db_handle(stmt), ctxStmt));
 
 	for (row = 0; rc == SQLITE_ROW && (allRows || row < maxRows); row++) {
-		rc = sqlite3_step(stmt);
+		rc = stmt_step(&ctxStmt->steps, stmt);
 		ctxStmt->last_result_code = rc;
 		//debug_print("row: %i = step result: %i, requested rows: %li allRows: %i\n", row, rc, maxRows, allRows);
 		switch(rc) {
@@ -131,6 +175,7 @@ int cmd_sqlite_step(RXIFRM* frm, void* reb_ctx) {
 							type = RXT_STRING;
 							bytes = sqlite3_column_bytes(stmt, col);
 							arg.series = RL_DECODE_UTF_STRING((REBYTE*)sqlite3_column_text(stmt, col), bytes, 8, 0, 0);
+							series_made(&made, arg.series);
 							break;
 						case SQLITE_BLOB:
 							type = RXT_BINARY;
@@ -141,6 +186,7 @@ int cmd_sqlite_step(RXIFRM* frm, void* reb_ctx) {
 								memcpy(SERIES_DATA(ser), bin, bytes);
 								SERIES_TAIL(ser) = bytes;
 								arg.series = ser;
+								series_made(&made, ser);
 							}
 							break;
 						case SQLITE_NULL:
@@ -153,7 +199,11 @@ int cmd_sqlite_step(RXIFRM* frm, void* reb_ctx) {
 				break;
 			case SQLITE_DONE:
 				//trace("step done");
-				if(blk) return RXR_VALUE;
+				if(blk) {
+					series_made(&made, blk);
+					result_made(ctx, ctxStmt, &made);
+					return RXR_VALUE;
+				}
 				sqlite3_reset(stmt);
 				return RXR_NONE;
 			case SQLITE_BUSY:
@@ -174,9 +224,15 @@ int cmd_sqlite_step(RXIFRM* frm, void* reb_ctx) {
 	//debug_print("step result: %i\n", rc);
 	if (rc < SQLITE_ROW && rc != SQLITE_OK) {
 		rc = sqlite3_reset(stmt);
+		if (rc == SQLITE_INTERRUPT)
+			RETURN_SQLITE_ERROR("[SQLITE] %s", interrupt_message());
 		RXA_SERIES(frm, 1) = (void*)sqlite3_errstr(rc);
 		return RXR_ERROR;
 	}
-	if(blk) return RXR_VALUE;
+	if(blk) {
+		series_made(&made, blk);
+		result_made(ctx, ctxStmt, &made);
+		return RXR_VALUE;
+	}
 	return RXR_NONE;
 }
@@ -0,0 +1,32 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Use on your own risc!
+
+#include "sqlite-rebol-extension.h"
+
+int cmd_sqlite_time_limit(RXIFRM* frm, void* reb_ctx) {
+	REBHOB  *hob;
+	REBHOB  *hobStmt;
+	SQLITE_CONTEXT *ctx;
+	SQLITE_STMT *ctxStmt;
+	int limit = (int)MAX(0, MIN(RXA_INT64(frm, 2), MAX_I32));
+
+	hob = RXA_HANDLE(frm, 1);
+	if (hob->sym == Handle_SQLiteSTMT) {
+		RESOLVE_SQLITE_STMT(ctxStmt, 1);
+		ctxStmt->time_limit = limit;
+	}
+	else {
+		RESOLVE_SQLITE_CTX(ctx, 1);
+		ctx->time_limit = limit;
+	}
+	return RXR_UNSET;
+}
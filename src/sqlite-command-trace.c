@@ -11,49 +11,25 @@
 // Use on your own risc!
 
 #include "sqlite-rebol-extension.h"
-#include <inttypes.h>
-
-static double asDouble(uint64_t v) {
-    return ((int64_t)(v >> 11)) / (double)(1L << 53);
-}
-
-static int trace_callback(unsigned type, void* ctx,void* pStmt,void* pValue){
-	uint64_t* duration;
-
-	printf("TRACE[%u] ", type);
-
-	switch(type) {
-		case SQLITE_TRACE_STMT:
-			printf("STMT: %s\n", sqlite3_expanded_sql((sqlite3_stmt*)pStmt));
-			break;
-		case SQLITE_TRACE_PROFILE:
-			duration = pValue;
-			printf("PROFILE: %lluns\n", *duration);
-			break;
-		case SQLITE_TRACE_ROW:
-			puts("ROW");
-			break;
-		case SQLITE_TRACE_CLOSE:
-			puts("CLOSE");
-			break;
-		default:
-			puts("unknown");
-			break;
-	}
-	fflush(stdout);
-	return SQLITE_OK;
-}
 
 int cmd_sqlite_trace(RXIFRM* frm, void* reb_ctx) {
 	REBHOB  *hob;
 	SQLITE_CONTEXT *ctx;
 	unsigned mask;
+	i64 size = 0;
+	int rc;
 
 	RESOLVE_SQLITE_CTX(ctx, 1);
 	if(ctx && ctx->db) {
 		mask = RXA_INT64(frm, 2) & 0x0F;
-		//printf("mask: %u\n", mask);
-		sqlite3_trace_v2(ctx->db, mask, trace_callback, ctx);
+		if (RXA_REF(frm, 3)) {
+			size = RXA_INT64(frm, 4);
+			if (size < 1 || size > 1000000)
+				RETURN_STR_ERROR("[SQLITE] Trace buffer size must be in range 1-1000000!");
+		}
+		rc = trace_start(ctx, mask, (u32)size, RXA_REF(frm, 5));
+		if (rc != SQLITE_OK)
+			RETURN_SQLITE_ERROR("[SQLITE] %s", sqlite3_errstr(rc));
 	}
 	return RXR_UNSET;
 }
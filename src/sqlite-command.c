@@ -19,6 +19,58 @@ REBSER *utf8_string(RXIARG arg) {
 }
 
 
+// Appends `name: value` to the block (time is in nanoseconds).
+void append_field(REBSER *blk, const char *name, i64 value, int type) {
+	RXIARG arg;
+	arg.int32a = RL_MAP_WORD((REBYTE*)name);
+	RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_SET_WORD);
+	if (type == RXT_LOGIC) arg.int32a = (value != 0);
+	else arg.int64 = value;
+	RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, type);
+}
+
+// Appends `name: "text"` to the block (none for NULL).
+void append_text(REBSER *blk, const char *name, const char *text) {
+	RXIARG arg;
+	arg.int32a = RL_MAP_WORD((REBYTE*)name);
+	RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_SET_WORD);
+	if (!text) {
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_NONE);
+		return;
+	}
+	arg.series = RL_DECODE_UTF_STRING((REBYTE*)text, (REBCNT)strlen(text), 8, 0, 0);
+	arg.index  = 0;
+	RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_STRING);
+}
+
+// Steps the statement and accumulates the time and rows in `steps` (if any)
+// and the time of the current command, when commands are timed. Each thread
+// must use its own `steps`. Steps of helper threads (prefetch, async worker)
+// are not part of the command running on the interpreter's thread.
+int stmt_step(SQLITE_STEP_STATS *steps, sqlite3_stmt *stmt) {
+	REBOOL timed = (call_flags & TIMING) && !thread_is_helper();
+	i64 time;
+	int rc;
+
+	if (!steps && !timed) return blocking_step(stmt);
+	time = monotonic_ns();
+	rc = blocking_step(stmt);
+	time = monotonic_ns() - time;
+	if (timed) command_step_ns += time;
+	if (steps) {
+		steps->time += time;
+		if (rc == SQLITE_ROW) steps->rows++;
+	}
+	return rc;
+}
+
+// Moves statistics collected by a helper thread to the statement.
+void steps_add(SQLITE_STEP_STATS *to, SQLITE_STEP_STATS *from) {
+	to->time += from->time;
+	to->rows += from->rows;
+	CLEARS(from);
+}
+
 REBOOL fetch_word(REBSER *cmds, REBCNT index, u32* words, REBCNT *cmd) {
 	RXIARG arg;
 	REBCNT type = RL_GET_VALUE(cmds, index, &arg);
@@ -22,38 +22,320 @@
 #define trace(str) 
 #endif
 
-#define DOUBLE_BUFFER_SIZE 16
-#define ARG_BUFFER_SIZE    8
+#define SQLITE_CTX_KEY     "rebol-sqlite-ctx" // client data of connections made by `open`
 
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+
+typedef struct sqlite_thread SQLITE_THREAD;
+typedef struct sqlite_lock   SQLITE_LOCK;   // mutex with a condition variable
+
+// Values stored outside of Rebol series (see sqlite-rows.c)
+typedef struct reb_sqlite_rows {
+	REBYTE* data;
+	size_t  used;
+	size_t  size;
+	int     columns;
+	i64     count;    // number of rows
+} SQLITE_ROWS;
+
+typedef struct reb_sqlite_worker SQLITE_WORKER;
+
+// Busy policy and lock contention statistics (see sqlite-command-busy.c)
+typedef struct reb_sqlite_busy {
+	int     timeout;      // ms
+	int     delay_min;    // backoff delays in ms (0 = SQLite's default delays)
+	int     delay_max;
+	REBSER* object;       // holds the callback function (protected from GC)
+	u32     word;         // name of the callback function
+	i64     started;      // ms, when the current wait started
+	// statistics
+	i64     waits;        // how many times a lock was not available at once
+	i64     retries;
+	i64     failures;     // waits ended with SQLITE_BUSY
+	i64     wait_time;    // ms spent waiting
+	i64     max_wait;     // ms, the longest single wait
+} SQLITE_BUSY_POLICY;
+
+typedef struct reb_sqlite_checkpointer SQLITE_CHECKPOINTER;
+
+// Recorded trace event (see sqlite-trace.c)
+#define TRACE_SQL_SIZE 120
+typedef struct reb_sqlite_trace_event {
+	i64   time;       // ns, monotonic clock
+	i64   duration;   // ns, SQLITE_TRACE_PROFILE only
+	u32   hash;       // of the statement's SQL text
+	u32   type;       // SQLITE_TRACE_*
+	char  sql[TRACE_SQL_SIZE]; // truncated
+} SQLITE_TRACE_EVENT;
+
+typedef struct reb_sqlite_trace SQLITE_TRACE_LOG;
+typedef struct reb_sqlite_plans SQLITE_PLANS;
+
+// Rebol series made for one result, counted where its values are made
+typedef struct reb_sqlite_made {
+	i64 series;
+	i64 bytes;
+} SQLITE_MADE;
+
+// Rebol series made for results of queries (see result_made)
+typedef struct reb_sqlite_result_memory {
+	i64 results;
+	i64 series;
+	i64 bytes;
+	i64 peak;               // bytes of the largest result
+} SQLITE_RESULT_MEMORY;
 
 typedef struct reb_sqlite_context {
 	sqlite3* db;
 	REBSER* buf;
 	int id;
 	int last_insert_count;
+	SQLITE_WORKER* worker;  // started by the first async query
+	const char* vfs;        // used to open the read connections
+	sqlite3** readers;      // pooled read-only connections used by `fan-out`
+	SQLITE_BUSY_POLICY* readers_busy; // their copies of the busy policy
+	int readers_count;
+	SQLITE_BUSY_POLICY busy;
+	SQLITE_CHECKPOINTER* checkpointer; // set by `auto-checkpoint`
+	int time_limit;         // ms per query, 0 = no limit
+	SQLITE_TRACE_LOG* trace; // ring buffer of trace events and the slow-query log
+	SQLITE_RESULT_MEMORY memory;
 } SQLITE_CONTEXT;
 
+typedef struct reb_sqlite_prefetch SQLITE_PREFETCH;
+
+// Accumulated by stmt_step. Helper threads fill their own copy (of a prefetch
+// batch or a job), which is added to the statement's one under their lock.
+typedef struct reb_sqlite_step_stats {
+	i64 time;               // ns spent in sqlite3_step
+	i64 rows;               // rows returned by sqlite3_step
+} SQLITE_STEP_STATS;
+
 typedef struct reb_sqlite_stmt {
 	sqlite3_stmt* stmt;
 	int last_result_code;
+	volatile int busy;      // used by an async query
+	SQLITE_WORKER* worker;  // referenced, when it was used by an async query
+	int prefetch_size;      // rows per prefetched batch (0 = no prefetch)
+	SQLITE_PREFETCH* prefetch;
+	int time_limit;         // ms per step call, 0 = limit of the connection
+	SQLITE_STEP_STATS steps; // on any thread (published ones)
+	SQLITE_RESULT_MEMORY memory;
 } SQLITE_STMT;
 
+// Handle of a WAL snapshot (see sqlite-snapshot.c)
+typedef struct reb_sqlite_snapshot {
+	sqlite3_snapshot* snapshot;
+} SQLITE_SNAPSHOT;
+
+typedef struct reb_sqlite_batch {
+	SQLITE_ROWS   rows;
+	size_t        pos;      // position of the first not converted row
+	int           rc;       // SQLITE_ROW if there are more rows after the batch
+	REBOOL        full;     // owned by the reader
+	SQLITE_STEP_STATS steps; // added to the statement by the reader
+} SQLITE_BATCH;
+
+struct reb_sqlite_prefetch {
+	SQLITE_THREAD* thread;
+	SQLITE_LOCK*   lock;
+	sqlite3_stmt*  stmt;
+	SQLITE_STMT*   ctxStmt;
+	int            size;
+	SQLITE_BATCH   batch[2];
+	int            fill;    // batch being filled by the helper thread
+	int            take;    // batch being converted by the reader
+	volatile REBOOL stop;
+};
+
+typedef struct reb_sqlite_job {
+	struct reb_sqlite_job* next;
+	int           id;
+	REBOOL        step;     // step/rows, else eval
+	sqlite3_stmt* stmt;
+	SQLITE_STMT*  ctxStmt;  // NULL when the statement was prepared for the job
+	i64           maxRows;  // step only, 0 = all rows
+	int           time_limit; // ms, 0 = no limit
+	SQLITE_ROWS   params;   // captured parameter sets
+	SQLITE_ROWS   rows;     // result
+	i64           changes;
+	SQLITE_STEP_STATS steps; // added to the statement when finished
+	int           rc;
+	char*         error;    // sqlite3_malloc'd message of a failed job
+	i64           queued;   // monotonic ms
+} SQLITE_JOB;
+
+struct reb_sqlite_worker {
+	SQLITE_THREAD* thread;
+	SQLITE_LOCK*   lock;
+	SQLITE_JOB*    queue;   // waiting jobs
+	SQLITE_JOB*    current;
+	SQLITE_JOB*    done;    // finished jobs waiting for the `result` call
+	int            next_id;
+	int            refs;    // the connection and statements used by jobs
+	REBOOL         stop;
+	int            group_delay;  // ms the first write waits for others (0 = no group commit)
+	int            group_writes; // max writes committed together
+};
+
+// WAL auto-checkpoint (see sqlite-checkpoint.c)
+struct reb_sqlite_checkpointer {
+	SQLITE_LOCK*   lock;
+	SQLITE_THREAD* thread;  // only in the background mode
+	sqlite3*       db;      // own connection of the background thread
+	int            frames;  // checkpoint when the WAL has at least this frames
+	REBOOL         pending;
+	REBOOL         stop;
+	// statistics
+	i64            commits;
+	i64            logged;       // frames written to the WAL
+	int            wal_frames;   // frames in the WAL after the last commit
+	i64            checkpoints;
+	i64            incomplete;   // checkpoints stopped by readers or writers
+	int            log;          // frames in the WAL at the last checkpoint
+	int            checkpointed; // frames of them copied into the database
+};
+
 
 REBSER* utf8_string(RXIARG arg);
 REBOOL fetch_word (REBSER *cmds, REBCNT index, u32* words, REBCNT *cmd);
 REBOOL fetch_mode (REBSER *cmds, REBCNT index, REBCNT *result, REBCNT start, REBCNT max);
 REBOOL fetch_color(REBSER *cmds, REBCNT index, REBCNT *cmd);
+void   append_field(REBSER *blk, const char *name, i64 value, int type);
+void   append_text(REBSER *blk, const char *name, const char *text);
+int    stmt_step(SQLITE_STEP_STATS *steps, sqlite3_stmt *stmt);
+void   steps_add(SQLITE_STEP_STATS *to, SQLITE_STEP_STATS *from);
 
 void* releaseTestExtensionCtx(void* ctx);
 void* releaseSQLiteSTMTHandle(void* hndl);
+void* releaseSQLiteSNAPSHOTHandle(void* hndl);
+void  arm_gc_sentinel(void);
+
+int lz4_compress_bound(int size);
+int lz4_compress(const REBYTE *src, int size, REBYTE *dst, int capacity);
+int lz4_decompress(const REBYTE *src, int size, REBYTE *dst, int capacity);
+const char* register_compressed_vfs(void);
+int configure_pool_allocator(void);
+int configure_system_allocator(void);
+int configure_page_cache(int page_size, int pages);
+
+SQLITE_THREAD* thread_start(void (*func)(void *arg), void *arg);
+void thread_join(SQLITE_THREAD *thread);
+SQLITE_LOCK* lock_new(void);
+void lock_free(SQLITE_LOCK *lock);
+void lock_enter(SQLITE_LOCK *lock);
+void lock_leave(SQLITE_LOCK *lock);
+void lock_wait(SQLITE_LOCK *lock);
+void lock_notify(SQLITE_LOCK *lock);
+void lock_wait_ms(SQLITE_LOCK *lock, int ms);
+REBOOL thread_is_helper(void);
+i64  monotonic_ms(void);
+i64  monotonic_ns(void);
+
+int  rows_append(SQLITE_ROWS *rows, sqlite3_stmt *stmt);
+int  rows_capture(SQLITE_ROWS *rows, REBSER *params, REBCNT index, int count);
+int  rows_bind(SQLITE_ROWS *rows, size_t *pos, sqlite3_stmt *stmt);
+i64  rows_convert(SQLITE_ROWS *rows, size_t *pos, i64 max, REBSER *blk, SQLITE_MADE *made);
+REBSER* rows_to_block(SQLITE_ROWS *rows, SQLITE_MADE *made);
+const REBYTE* rows_column(SQLITE_ROWS *rows, size_t pos, int col);
+int  rows_compare(const REBYTE *a, const REBYTE *b);
+void rows_clear(SQLITE_ROWS *rows);
+void rows_free(SQLITE_ROWS *rows);
+
+REBOOL worker_allowed(void);
+int  worker_eval(SQLITE_CONTEXT *ctx, sqlite3_stmt *stmt, SQLITE_STMT *ctxStmt, REBSER *params, REBCNT index, int limit, int *id);
+int  worker_step(SQLITE_STMT *ctxStmt, i64 maxRows, REBSER *params, int *id);
+int  worker_group_commit(SQLITE_CONTEXT *ctx, int delay, int writes);
+SQLITE_JOB* worker_take(SQLITE_WORKER *worker, int wait, REBOOL *late);
+void worker_wait_stmt(SQLITE_WORKER *worker, SQLITE_STMT *ctxStmt);
+void worker_stop(SQLITE_WORKER *worker);
+void worker_release(SQLITE_WORKER *worker);
+void job_free(SQLITE_JOB *job);
+
+int  busy_handler(void *data, int count); // data is SQLITE_BUSY_POLICY*
+void busy_release(SQLITE_CONTEXT *ctx);
+
+int  checkpointer_start(SQLITE_CONTEXT *ctx, int frames, REBOOL background);
+void checkpointer_stop(SQLITE_CONTEXT *ctx);
+
+int  blocking_step(sqlite3_stmt *stmt);
+
+int  deadline_limit(sqlite3 *db, SQLITE_STMT *ctxStmt);
+void deadline_start(sqlite3 *db, int ms);
+void deadline_clear(void);
+const char* interrupt_message(void);
+
+int  snapshot_take(sqlite3 *db, sqlite3_snapshot **snapshot);
+int  snapshot_begin(sqlite3 *db, sqlite3_snapshot *snapshot);
+int  snapshot_compare(sqlite3_snapshot *a, sqlite3_snapshot *b);
+void snapshot_free(sqlite3_snapshot *snapshot);
+
+u32  sql_hash(const char *sql);
+int  trace_start(SQLITE_CONTEXT *ctx, unsigned mask, u32 size, REBOOL expanded);
+int  trace_drain(SQLITE_CONTEXT *ctx, REBSER *blk);
+void trace_ignore(REBOOL on);
+u32  sql_fingerprint(const char *sql, char *out, size_t size);
+int  slow_log_start(SQLITE_CONTEXT *ctx, i64 ms);
+int  slow_log_drain(SQLITE_CONTEXT *ctx, REBSER *blk);
+int  query_stats_start(SQLITE_CONTEXT *ctx, REBOOL on);
+int  query_stats_read(SQLITE_CONTEXT *ctx, REBSER *blk, REBOOL reset);
+int  advisor_start(SQLITE_CONTEXT *ctx, REBOOL on, i64 threshold);
+int  advisor_drain(SQLITE_CONTEXT *ctx, REBSER *blk);
+int  plans_watch(SQLITE_CONTEXT *ctx, REBOOL on);
+SQLITE_PLANS* plans_watched(SQLITE_CONTEXT *ctx);
+int  trace_export(SQLITE_CONTEXT *ctx, const char *path);
+void trace_release(SQLITE_CONTEXT *ctx);
+
+void    advisor_log(void *arg, int code, const char *msg);
+REBSER* advise_indexes(sqlite3 *db, sqlite3 *adb, const char *sql);
+
+SQLITE_PLANS* plans_new(void);
+void plans_free(SQLITE_PLANS *plans);
+void plans_finished(SQLITE_PLANS *plans, sqlite3_stmt *stmt);
+void plans_check(SQLITE_PLANS *plans, sqlite3 *db);
+int  plans_load(SQLITE_PLANS *plans, sqlite3_mutex *mutex, REBSER *blk, REBCNT index);
+void plans_read(SQLITE_PLANS *plans, sqlite3 *db, REBSER *blk);
+int  plans_drain(SQLITE_PLANS *plans, sqlite3 *db, REBSER *blk);
+
+int  export_open(const char *path, const char *name, int *track);
+void export_close(void);
+REBOOL export_writing(const char *path);
+void export_statement(int track, sqlite3_stmt *stmt, i64 duration, i64 rows, int *counters);
+void export_command(const char *name, i64 start, i64 end);
+
+void command_stats_start(REBOOL on);
+void command_finished(int cmd, i64 time, SQLITE_MADE *made);
+void command_stats_read(REBSER *blk, REBOOL reset);
+void series_made(SQLITE_MADE *made, REBSER *ser);
+void result_made(SQLITE_CONTEXT *ctx, SQLITE_STMT *ctxStmt, SQLITE_MADE *made);
+
+int  readers_reserve(SQLITE_CONTEXT *ctx, int count);
+void readers_close(SQLITE_CONTEXT *ctx);
+
+int  prefetch_step(SQLITE_STMT *ctxStmt, i64 maxRows, REBSER **blk, SQLITE_MADE *made);
+void prefetch_stop(SQLITE_STMT *ctxStmt);
 
 
 extern u32* words_sqlite_cmd;
 extern u32* words_sqlite_arg;
+extern int  release_on_recycle;
+extern int  threading_mode;
+extern int  call_flags;
+extern THREAD_LOCAL i64 command_bind_ns;
+extern THREAD_LOCAL i64 command_step_ns;
+extern SQLITE_MADE command_made;
 
-
-extern REBDEC doubles[DOUBLE_BUFFER_SIZE];
-extern RXIARG arg[ARG_BUFFER_SIZE];
+// call_flags (set on the main thread), RX_Call does more than calling the command when not 0
+#define TIMING_EXPORT 1 // command spans are written by the trace exporter
+#define TIMING_STATS  2 // statistics of commands are collected
+#define TIMING        (TIMING_EXPORT | TIMING_STATS)
+#define CALL_RECYCLE  4 // the recycle sentinel is re-armed (release-memory/auto)
+#define CALL_DEADLINE 8 // a time limit was started by the current command
 
 
 //==============================================================//
@@ -64,6 +346,12 @@ extern RXIARG arg[ARG_BUFFER_SIZE];
 
 #define RETURN_STR_ERROR(str) do {RXA_SERIES(frm, 1) = str; return RXR_ERROR;} while(0);
 
+#define RETURN_SQLITE_ERROR(fmt, ...) do {                           \
+		snprintf(error_buffer, sizeof(error_buffer), fmt, __VA_ARGS__); \
+		RXA_SERIES(frm, 1) = (void*)error_buffer;                      \
+		return RXR_ERROR;                                              \
+	} while(0)
+
 
 #define RESOLVE_UTF8_STRING(n, i) \
 	n   = RXA_SERIES(frm, i);     \
@@ -80,5 +368,13 @@ extern RXIARG arg[ARG_BUFFER_SIZE];
 			hobStmt = RXA_HANDLE(frm, i);           \
 			n = (SQLITE_STMT*)hobStmt->data;        \
 			if(!n || hobStmt->sym != Handle_SQLiteSTMT || !(n)->stmt) \
-				RETURN_STR_ERROR("Invalid SQLite STMT handle!");
+				RETURN_STR_ERROR("Invalid SQLite STMT handle!");  \
+			if((n)->busy)                           \
+				RETURN_STR_ERROR("[SQLITE] Statement is used by an async query!");
+
+#define RESOLVE_SQLITE_SNAPSHOT(n, i)               \
+			hobSnap = RXA_HANDLE(frm, i);           \
+			n = (SQLITE_SNAPSHOT*)hobSnap->data;    \
+			if(!n || hobSnap->sym != Handle_SQLiteSNAPSHOT || !(n)->snapshot) \
+				RETURN_STR_ERROR("Invalid SQLite snapshot handle!");
 
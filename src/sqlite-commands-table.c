@@ -11,18 +11,90 @@
 
 #include "sqlite-rebol-extension.h"
 MyCommandPointer Command[] = {
+	cmd_sqlite_init_words,
 	cmd_sqlite_info,
+	cmd_sqlite_command_stats,
 	cmd_sqlite_open,
 	cmd_sqlite_exec,
 	cmd_sqlite_eval,
+	cmd_sqlite_fan_out,
 	cmd_sqlite_last_insert_id,
 	cmd_sqlite_finalize,
 	cmd_sqlite_trace,
+	cmd_sqlite_trace_events,
+	cmd_sqlite_trace_export,
+	cmd_sqlite_query_stats,
+	cmd_sqlite_index_advisor,
+	cmd_sqlite_index_advice,
+	cmd_sqlite_plan_watch,
+	cmd_sqlite_plan_changes,
+	cmd_sqlite_scan_status,
+	cmd_sqlite_slow_log,
+	cmd_sqlite_busy,
+	cmd_sqlite_contention,
+	cmd_sqlite_checkpoint,
+	cmd_sqlite_auto_checkpoint,
+	cmd_sqlite_snapshot,
+	cmd_sqlite_snapshot_open,
+	cmd_sqlite_snapshot_compare,
+	cmd_sqlite_snapshot_free,
+	cmd_sqlite_group_commit,
+	cmd_sqlite_time_limit,
+	cmd_sqlite_interrupt,
 	cmd_sqlite_prepare,
 	cmd_sqlite_reset,
 	cmd_sqlite_step,
+	cmd_sqlite_prefetch,
+	cmd_sqlite_result,
 	cmd_sqlite_close,
 	cmd_sqlite_columns,
 	cmd_sqlite_initialize,
 	cmd_sqlite_shutdown,
+	cmd_sqlite_soft_heap_limit,
+	cmd_sqlite_hard_heap_limit,
+	cmd_sqlite_release_memory,
+};
+const char* Command_Name[] = {
+	"init-words",
+	"info",
+	"command-stats",
+	"open",
+	"exec",
+	"eval",
+	"fan-out",
+	"last-insert-id",
+	"finalize",
+	"trace",
+	"trace-events",
+	"trace-export",
+	"query-stats",
+	"index-advisor",
+	"index-advice",
+	"plan-watch",
+	"plan-changes",
+	"scan-status",
+	"slow-log",
+	"busy",
+	"contention",
+	"checkpoint",
+	"auto-checkpoint",
+	"snapshot",
+	"snapshot-open",
+	"snapshot-compare",
+	"snapshot-free",
+	"group-commit",
+	"time-limit",
+	"interrupt",
+	"prepare",
+	"reset",
+	"step",
+	"prefetch",
+	"result",
+	"close",
+	"columns",
+	"initialize",
+	"shutdown",
+	"soft-heap-limit",
+	"hard-heap-limit",
+	"release-memory",
 };
@@ -0,0 +1,65 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Time limits of queries (`time-limit` command and `eval/timeout`).
+//
+// A query is always evaluated by a single thread, so its deadline is kept
+// per thread. The progress handler checks it every PROGRESS_STEPS virtual
+// machine instructions and the query fails with SQLITE_INTERRUPT when it is
+// reached. The deadline is cleared after each command which started it (see
+// RX_Call) and after each async job.
+
+#include "sqlite-rebol-extension.h"
+
+#define PROGRESS_STEPS 1000
+
+static THREAD_LOCAL i64    deadline = 0; // monotonic ms, 0 = no limit
+static THREAD_LOCAL REBOOL expired  = FALSE;
+
+static int progress_handler(void *data) {
+	if (deadline && monotonic_ms() >= deadline) {
+		expired = TRUE;
+		return 1;
+	}
+	return 0;
+}
+
+// Returns the limit (ms) of the statement or of its connection.
+int deadline_limit(sqlite3 *db, SQLITE_STMT *ctxStmt) {
+	SQLITE_CONTEXT *ctx;
+	if (ctxStmt && ctxStmt->time_limit) return ctxStmt->time_limit;
+	ctx = sqlite3_get_clientdata(db, SQLITE_CTX_KEY);
+	return ctx ? ctx->time_limit : 0;
+}
+
+// Starts counting the time of a query evaluated on this thread (ms <= 0 = no limit).
+void deadline_start(sqlite3 *db, int ms) {
+	expired = FALSE;
+	if (ms <= 0) {
+		deadline = 0;
+		return;
+	}
+	deadline = monotonic_ms() + ms;
+	// so RX_Call clears it after the command
+	if (!thread_is_helper()) call_flags |= CALL_DEADLINE;
+	// does nothing on threads without a deadline, so it is never removed
+	sqlite3_progress_handler(db, PROGRESS_STEPS, progress_handler, NULL);
+}
+
+void deadline_clear(void) {
+	deadline = 0;
+	expired  = FALSE;
+	if (!thread_is_helper()) call_flags &= ~CALL_DEADLINE;
+}
+
+// Reason of a query failed with SQLITE_INTERRUPT.
+const char* interrupt_message(void) {
+	return expired ? "Query timed out!" : "Query interrupted!";
+}
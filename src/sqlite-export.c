@@ -0,0 +1,153 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Export of statement and command timings in the Chrome trace event format
+// (a JSON array of events), which may be opened in chrome://tracing, Perfetto
+// or converted to a flame graph.
+//
+// There is one file per process. Each exporting connection has its own track
+// (thread id) with complete events of its finished statements, named by the
+// fingerprint of their SQL. Extension commands are written into the track 0
+// with time spent binding parameters and stepping statements; the rest of
+// their time is mostly conversion of values to and from Rebol.
+//
+// Statements may finish on any thread, so writes are serialized by a lock.
+// The file is closed when the last connection stops exporting.
+
+#include "sqlite-rebol-extension.h"
+#include <string.h>
+
+static SQLITE_LOCK *export_lock;
+static FILE  *export_file;
+static char  *export_path;
+static int    export_users;  // connections writing into the file
+static int    export_tracks; // last used track id
+static i64    export_origin; // ns, time 0 of the file
+
+#define US(ns) ((double)(ns) / 1000.0)
+
+static void write_string(const char *str) {
+	REBYTE c;
+	fputc('"', export_file);
+	while ((c = (REBYTE)*str++)) {
+		if (c == '"' || c == '\\') fprintf(export_file, "\\%c", c);
+		else if (c < 0x20) fprintf(export_file, "\\u%04x", c);
+		else fputc(c, export_file);
+	}
+	fputc('"', export_file);
+}
+
+static void write_track_name(int track, const char *name) {
+	fprintf(export_file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":", track);
+	write_string(name);
+	fputs("}}", export_file);
+}
+
+// Starts writing into the file (or joins the already open one) with a new
+// track of the given name. Only one file may be written at once.
+int export_open(const char *path, const char *name, int *track) {
+	int rc = SQLITE_OK;
+
+	if (!export_lock && !(export_lock = lock_new())) return SQLITE_NOMEM;
+	lock_enter(export_lock);
+	if (export_file && strcmp(path, export_path)) {
+		rc = SQLITE_MISUSE;
+	}
+	else if (!export_file) {
+		if (!(export_path = malloc(strlen(path) + 1))) rc = SQLITE_NOMEM;
+		else if (!(export_file = fopen(path, "wb"))) {
+			free(export_path);
+			export_path = NULL;
+			rc = SQLITE_CANTOPEN;
+		}
+		else {
+			strcpy(export_path, path);
+			export_origin = monotonic_ns();
+			fputs("[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Rebol/SQLite\"}}", export_file);
+			write_track_name(0, "commands");
+			call_flags |= TIMING_EXPORT;
+		}
+	}
+	if (rc == SQLITE_OK) {
+		export_users++;
+		*track = ++export_tracks;
+		write_track_name(*track, name);
+	}
+	lock_leave(export_lock);
+	return rc;
+}
+
+// Stops writing of one connection, the file is closed after the last one.
+void export_close(void) {
+	if (!export_lock) return;
+	lock_enter(export_lock);
+	if (export_file && --export_users == 0) {
+		call_flags &= ~TIMING_EXPORT;
+		fputs("\n]\n", export_file);
+		fclose(export_file);
+		free(export_path);
+		export_file = NULL;
+		export_path = NULL;
+		export_tracks = 0;
+	}
+	lock_leave(export_lock);
+}
+
+REBOOL export_writing(const char *path) {
+	REBOOL writing;
+	if (!export_lock) return FALSE;
+	lock_enter(export_lock);
+	writing = export_file && !strcmp(path, export_path);
+	lock_leave(export_lock);
+	return writing;
+}
+
+// Writes the finished run of the statement (called by the trace callback).
+void export_statement(int track, sqlite3_stmt *stmt, i64 duration, i64 rows, int *counters) {
+	char name[TRACE_SQL_SIZE];
+	const char *sql = sqlite3_sql(stmt);
+	size_t len;
+	i64 end = monotonic_ns();
+
+	sql_fingerprint(sql, name, TRACE_SQL_SIZE);
+	// the truncated name must not end with a part of an UTF-8 sequence
+	len = strlen(name);
+	if (len == TRACE_SQL_SIZE - 1) {
+		while (len > 0 && ((REBYTE)name[len - 1] & 0xC0) == 0x80) len--;
+		if (len > 0 && (REBYTE)name[len - 1] >= 0xC0) name[len - 1] = 0;
+	}
+	lock_enter(export_lock);
+	if (export_file) {
+		fputs(",\n{\"name\":", export_file);
+		write_string(name);
+		fprintf(export_file, ",\"cat\":\"sql\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"sql\":",
+			track, US(end - duration - export_origin), US(duration));
+		write_string(sql ? sql : "");
+		fprintf(export_file, ",\"rows\":%lld,\"vm-steps\":%i,\"fullscan-steps\":%i,\"sorts\":%i}}",
+			(long long)rows, counters[3], counters[0], counters[1]);
+	}
+	lock_leave(export_lock);
+}
+
+// Writes the extension command with times collected while it was running.
+void export_command(const char *name, i64 start, i64 end) {
+	i64 other = end - start - command_bind_ns - command_step_ns;
+
+	lock_enter(export_lock);
+	if (export_file) {
+		fputs(",\n{\"name\":", export_file);
+		write_string(name);
+		fprintf(export_file, ",\"cat\":\"command\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f"
+			",\"args\":{\"bind-us\":%.3f,\"step-us\":%.3f,\"convert-us\":%.3f}}",
+			US(start - export_origin), US(end - start),
+			US(command_bind_ns), US(command_step_ns), US(other > 0 ? other : 0));
+	}
+	lock_leave(export_lock);
+}
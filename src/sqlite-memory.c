@@ -0,0 +1,188 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Memory configuration used by `initialize/with`
+//
+// The pooled allocator keeps free lists for a set of size classes matching
+// the most common SQLite requests (small parser/VDBE objects, Mem cells and
+// page cache entries). Chunks are carved from 64kB arenas which are never
+// returned to the system, so freed memory is reused without a malloc call.
+// Requests larger than the biggest class go to the system allocator.
+
+#include "sqlite-rebol-extension.h"
+#include <string.h>
+
+#define POOL_ARENA_SIZE  65536
+#define POOL_HEADER      8      // keeps the 8 byte alignment required by SQLite
+#define POOL_LARGE       0xFF   // class id of blocks allocated by system malloc
+
+static const int pool_classes[] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 4608, 8192
+};
+#define POOL_CLASSES (sizeof(pool_classes) / sizeof(pool_classes[0]))
+
+typedef struct pool_block {
+	struct pool_block *next;
+} POOL_BLOCK;
+
+typedef struct pool_arena {
+	struct pool_arena *next;
+} POOL_ARENA;
+
+static struct {
+	sqlite3_mutex *mutex;
+	POOL_BLOCK    *free[POOL_CLASSES];
+	POOL_ARENA    *arenas;
+	REBYTE        *top;   // unused part of the current arena
+	REBYTE        *end;
+} pool;
+
+static sqlite3_mem_methods system_methods;
+static void *page_cache_slab = NULL;
+
+static int pool_class(int size) {
+	int i;
+	for (i = 0; i < (int)POOL_CLASSES; i++) {
+		if (size <= pool_classes[i]) return i;
+	}
+	return -1;
+}
+
+static REBYTE* pool_carve(int bytes) {
+	REBYTE *p;
+	POOL_ARENA *arena;
+	if (pool.top + bytes > pool.end) {
+		arena = malloc(POOL_ARENA_SIZE);
+		if (!arena) return NULL;
+		arena->next = pool.arenas;
+		pool.arenas = arena;
+		pool.top = (REBYTE*)arena + POOL_HEADER;
+		pool.end = (REBYTE*)arena + POOL_ARENA_SIZE;
+	}
+	p = pool.top;
+	pool.top += bytes;
+	return p;
+}
+
+static void *poolMalloc(int size) {
+	REBYTE *p;
+	int cls = pool_class(size);
+
+	if (cls < 0) {
+		p = malloc(POOL_HEADER + size);
+		if (!p) return NULL;
+		p[0] = POOL_LARGE;
+		*(int*)(p + 4) = size;
+		return p + POOL_HEADER;
+	}
+	sqlite3_mutex_enter(pool.mutex);
+	if (pool.free[cls]) {
+		p = (REBYTE*)pool.free[cls];
+		pool.free[cls] = pool.free[cls]->next;
+	} else {
+		p = pool_carve(POOL_HEADER + pool_classes[cls]);
+	}
+	sqlite3_mutex_leave(pool.mutex);
+	if (!p) return NULL;
+	p[0] = (REBYTE)cls;
+	return p + POOL_HEADER;
+}
+
+static void poolFree(void *ptr) {
+	REBYTE *p = (REBYTE*)ptr - POOL_HEADER;
+	int cls = p[0];
+	if (cls == POOL_LARGE) {
+		free(p);
+		return;
+	}
+	sqlite3_mutex_enter(pool.mutex);
+	((POOL_BLOCK*)p)->next = pool.free[cls];
+	pool.free[cls] = (POOL_BLOCK*)p;
+	sqlite3_mutex_leave(pool.mutex);
+}
+
+static int poolSize(void *ptr) {
+	REBYTE *p = (REBYTE*)ptr - POOL_HEADER;
+	if (p[0] == POOL_LARGE) return *(int*)(p + 4);
+	return pool_classes[p[0]];
+}
+
+static void *poolRealloc(void *ptr, int size) {
+	void *p;
+	int old = poolSize(ptr);
+	if (size <= old && pool_class(size) == pool_class(old)) return ptr;
+	p = poolMalloc(size);
+	if (!p) return NULL;
+	memcpy(p, ptr, old < size ? old : size);
+	poolFree(ptr);
+	return p;
+}
+
+static int poolRoundup(int size) {
+	int cls = pool_class(size);
+	return (cls < 0) ? ((size + 7) & ~7) : pool_classes[cls];
+}
+
+static int poolInit(void *data) {
+	pool.mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_APP1);
+	return SQLITE_OK;
+}
+
+static void poolShutdown(void *data) {
+	// Arenas are kept for the next initialization, because SQLite objects
+	// released by the GC may still be freed after the shutdown.
+}
+
+static const sqlite3_mem_methods pool_methods = {
+	poolMalloc,
+	poolFree,
+	poolRealloc,
+	poolSize,
+	poolRoundup,
+	poolInit,
+	poolShutdown,
+	NULL
+};
+
+int configure_pool_allocator(void) {
+	if (!system_methods.xMalloc) {
+		sqlite3_config(SQLITE_CONFIG_GETMALLOC, &system_methods);
+		if (system_methods.xMalloc == poolMalloc) system_methods.xMalloc = NULL;
+	}
+	return sqlite3_config(SQLITE_CONFIG_MALLOC, &pool_methods);
+}
+
+int configure_system_allocator(void) {
+	if (!system_methods.xMalloc) return SQLITE_OK; // pool was never used
+	return sqlite3_config(SQLITE_CONFIG_MALLOC, &system_methods);
+}
+
+int configure_page_cache(int page_size, int pages) {
+	int rc, hdr = 0;
+	void *slab;
+
+	if (page_size <= 0 || pages <= 0) {
+		return sqlite3_config(SQLITE_CONFIG_PAGECACHE, NULL, 0, 0);
+	}
+	// Each slot must hold the page and its page cache header.
+	sqlite3_config(SQLITE_CONFIG_PCACHE_HDRSZ, &hdr);
+	page_size = (page_size + hdr + 7) & ~7;
+	slab = malloc((size_t)page_size * pages);
+	if (!slab) return SQLITE_NOMEM;
+	rc = sqlite3_config(SQLITE_CONFIG_PAGECACHE, slab, page_size, pages);
+	if (rc != SQLITE_OK) {
+		free(slab);
+		return rc;
+	}
+	// The previous slab is not used, because the library is not initialized.
+	free(page_cache_slab);
+	page_cache_slab = slab;
+	return SQLITE_OK;
+}
@@ -0,0 +1,410 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Detection of query plan changes.
+//
+// The EXPLAIN QUERY PLAN output of statements is remembered per fingerprint
+// of their SQL. A plan is checked when a statement finishes its first run,
+// when it was prepared again during a run (schema change or ANALYZE, also
+// by another connection), and after a schema changing statement of this
+// connection. When the plan differs from the remembered one, both plans
+// are recorded into a bounded log of changes (see `plan-changes`).
+// The remembered plans may be returned as a block and loaded back, so
+// they can be compared across releases.
+//
+// Runs to be checked are found by the trace callback (with the connection's
+// mutex) and queued. No statement may be run from the callback, so their
+// plans are explained and compared on the main thread: before `exec` and
+// `eval` run statements (which may change the schema) and when the plans or
+// their changes are read. Statements expired by this connection are prepared
+// again before their run starts, so re-prepares are found by comparing the
+// REPREPARE counter with the value seen last time (in a small cache indexed
+// by the statement).
+
+#include "sqlite-rebol-extension.h"
+#include <string.h>
+
+#define PLANS_SIZE        1024 // remembered fingerprints
+#define PLAN_CHANGES_SIZE 64
+#define PLAN_ROWS         128  // rows of one plan with known depth
+#define PLAN_CHECKS_SIZE  64   // queued runs (more are not checked)
+#define SEEN_SIZE         256  // power of 2
+
+typedef struct plan {
+	u32   hash;        // of the fingerprint
+	u32   plan_hash;
+	u32   generation;  // when checked (0 = loaded, not checked yet)
+	char* fingerprint; // sqlite3_malloc
+	char* plan;        // one line per row, indented by its depth
+} PLAN;
+
+typedef struct plan_change {
+	i64   time;        // ns, monotonic clock
+	char* fingerprint;
+	char* sql;         // expanded SQL of the statement
+	char* old_plan;
+	char* new_plan;
+} PLAN_CHANGE;
+
+typedef struct plan_check {
+	u32   hash;        // of the fingerprint
+	u32   generation;  // when the run finished
+	char* fingerprint; // sqlite3_malloc
+	char* text;        // SQL of the statement to be explained
+	char* sql;         // expanded SQL of the run
+} PLAN_CHECK;
+
+typedef struct seen_stmt {
+	sqlite3_stmt* stmt;
+	int   reprepares;
+} SEEN_STMT;
+
+struct reb_sqlite_plans {
+	SEEN_STMT seen[SEEN_SIZE];
+	PLAN  plans[PLANS_SIZE];
+	u32   count;
+	u32   generation;  // incremented with schema changes
+	PLAN_CHANGE changes[PLAN_CHANGES_SIZE];
+	u64   changes_written;
+	u64   changes_taken;
+	PLAN_CHECK checks[PLAN_CHECKS_SIZE];
+	u32   checks_count;
+};
+
+SQLITE_PLANS* plans_new(void) {
+	SQLITE_PLANS *plans = calloc(1, sizeof(SQLITE_PLANS));
+	if (plans) plans->generation = 1;
+	return plans;
+}
+
+static void change_free(PLAN_CHANGE *change) {
+	sqlite3_free(change->fingerprint);
+	sqlite3_free(change->sql);
+	sqlite3_free(change->old_plan);
+	sqlite3_free(change->new_plan);
+	CLEARS(change);
+}
+
+static void check_free(PLAN_CHECK *check) {
+	sqlite3_free(check->fingerprint);
+	sqlite3_free(check->text);
+	sqlite3_free(check->sql);
+}
+
+void plans_free(SQLITE_PLANS *plans) {
+	u32 i;
+	if (!plans) return;
+	for (i = 0; i < plans->count; i++) {
+		sqlite3_free(plans->plans[i].fingerprint);
+		sqlite3_free(plans->plans[i].plan);
+	}
+	for (i = 0; i < PLAN_CHANGES_SIZE; i++) change_free(&plans->changes[i]);
+	for (i = 0; i < plans->checks_count; i++) check_free(&plans->checks[i]);
+	free(plans);
+}
+
+static PLAN* find_plan(SQLITE_PLANS *plans, u32 hash) {
+	u32 i;
+	for (i = 0; i < plans->count; i++) {
+		if (plans->plans[i].hash == hash) return &plans->plans[i];
+	}
+	return NULL;
+}
+
+// Fingerprint of the whole SQL (it is never longer than the SQL).
+static char* fingerprint_of(const char *sql, u32 *hash) {
+	size_t size = strlen(sql) + 1;
+	char *text = sqlite3_malloc64(size);
+	if (text) *hash = sql_fingerprint(sql, text, size);
+	return text;
+}
+
+static char* plan_text(sqlite3 *db, const char *sql) {
+	sqlite3_stmt *stmt = NULL;
+	sqlite3_str *str;
+	char *query;
+	int ids[PLAN_ROWS], depths[PLAN_ROWS];
+	int rows = 0, id, parent, depth, i;
+
+	if (!(query = sqlite3_mprintf("EXPLAIN QUERY PLAN %s", sql))) return NULL;
+	trace_ignore(TRUE);
+	if (SQLITE_OK != sqlite3_prepare_v2(db, query, -1, &stmt, NULL) || !stmt) {
+		trace_ignore(FALSE);
+		sqlite3_free(query);
+		return NULL;
+	}
+	str = sqlite3_str_new(db);
+	while (SQLITE_ROW == sqlite3_step(stmt)) {
+		// row ids are addresses of the program, so only the tree is kept
+		id     = sqlite3_column_int(stmt, 0);
+		parent = sqlite3_column_int(stmt, 1);
+		for (depth = 0, i = rows - 1; i >= 0; i--) {
+			if (ids[i] == parent) { depth = depths[i] + 1; break; }
+		}
+		if (rows < PLAN_ROWS) {
+			ids[rows] = id;
+			depths[rows++] = depth;
+		}
+		sqlite3_str_appendf(str, "%*s%s\n", depth * 2, "", sqlite3_column_text(stmt, 3));
+	}
+	sqlite3_finalize(stmt);
+	trace_ignore(FALSE);
+	sqlite3_free(query);
+	return sqlite3_str_finish(str); // NULL for an empty plan
+}
+
+static REBOOL changes_schema(sqlite3_stmt *stmt) {
+	static const char *keywords[] = {"CREATE", "DROP", "ALTER", "ANALYZE", "REINDEX", "PRAGMA", NULL};
+	const char *sql = sqlite3_sql(stmt);
+	int i;
+
+	if (!sql || sqlite3_stmt_readonly(stmt)) return FALSE;
+	while (*sql == ' ' || *sql == '\t' || *sql == '\r' || *sql == '\n') sql++;
+	for (i = 0; keywords[i]; i++) {
+		if (!sqlite3_strnicmp(sql, keywords[i], (int)strlen(keywords[i]))) return TRUE;
+	}
+	return FALSE;
+}
+
+static void record_change(SQLITE_PLANS *plans, PLAN *plan, PLAN_CHECK *check, char *new_plan) {
+	PLAN_CHANGE *change = &plans->changes[plans->changes_written % PLAN_CHANGES_SIZE];
+	change_free(change);
+	change->time        = monotonic_ns();
+	change->fingerprint = sqlite3_mprintf("%s", plan->fingerprint);
+	change->sql         = check->sql; // taken
+	check->sql          = NULL;
+	change->old_plan    = plan->plan;
+	change->new_plan    = sqlite3_mprintf("%s", new_plan);
+	plans->changes_written++;
+	if (plans->changes_written - plans->changes_taken > PLAN_CHANGES_SIZE)
+		plans->changes_taken = plans->changes_written - PLAN_CHANGES_SIZE;
+}
+
+// Called when a run of the statement finished (from the trace callback).
+// Queues the run when its plan should be checked.
+void plans_finished(SQLITE_PLANS *plans, sqlite3_stmt *stmt) {
+	SEEN_STMT *seen;
+	PLAN *plan;
+	PLAN_CHECK *check;
+	char *sql, *text;
+	u32 hash, i;
+	int reprepares;
+	REBOOL reprepared;
+
+	if (changes_schema(stmt)) {
+		plans->generation++;
+		return;
+	}
+	// only the first run of a prepared statement, unless it was prepared again
+	reprepares = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_REPREPARE, 0);
+	seen = &plans->seen[((size_t)stmt >> 4) & (SEEN_SIZE - 1)];
+	reprepared = seen->stmt == stmt && seen->reprepares != reprepares;
+	if (seen->stmt == stmt && !reprepared && sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_RUN, 0) > 1) return;
+	seen->stmt = stmt;
+	seen->reprepares = reprepares;
+	if (reprepared) plans->generation++;
+	if (!(sql = (char*)sqlite3_sql(stmt)) || !(text = fingerprint_of(sql, &hash))) return;
+
+	plan = find_plan(plans, hash);
+	if ((plan && plan->generation == plans->generation)
+	 || (!plan && plans->count == PLANS_SIZE)
+	 || plans->checks_count == PLAN_CHECKS_SIZE) {
+		sqlite3_free(text);
+		return;
+	}
+	for (i = 0; i < plans->checks_count; i++) {
+		if (plans->checks[i].hash == hash && plans->checks[i].generation == plans->generation) {
+			sqlite3_free(text);
+			return;
+		}
+	}
+	check = &plans->checks[plans->checks_count];
+	check->hash        = hash;
+	check->generation  = plans->generation;
+	check->fingerprint = text;
+	check->text        = sqlite3_mprintf("%s", sql);
+	check->sql         = sqlite3_expanded_sql(stmt);
+	if (!check->text) {
+		check_free(check);
+		return;
+	}
+	plans->checks_count++;
+}
+
+// Explains queued runs and records changes of their plans. The mutex is
+// released while a plan is made (main thread only).
+void plans_check(SQLITE_PLANS *plans, sqlite3 *db) {
+	sqlite3_mutex *mutex = sqlite3_db_mutex(db);
+	PLAN_CHECK checks[PLAN_CHECKS_SIZE], *check;
+	PLAN *plan;
+	char *text;
+	u32 count, plan_hash, i;
+
+	sqlite3_mutex_enter(mutex);
+	count = plans->checks_count;
+	memcpy(checks, plans->checks, count * sizeof(PLAN_CHECK));
+	plans->checks_count = 0;
+	sqlite3_mutex_leave(mutex);
+
+	for (i = 0; i < count; i++) {
+		check = &checks[i];
+		if (!(text = plan_text(db, check->text))) {
+			check_free(check);
+			continue;
+		}
+		plan_hash = sql_hash(text);
+		sqlite3_mutex_enter(mutex);
+		plan = find_plan(plans, check->hash);
+		if (!plan && plans->count < PLANS_SIZE) {
+			plan = &plans->plans[plans->count++];
+			plan->hash = check->hash;
+			plan->fingerprint = check->fingerprint;
+			plan->plan = text;
+			plan->plan_hash = plan_hash;
+			check->fingerprint = NULL;
+			text = NULL;
+		}
+		else if (plan && plan->generation != check->generation && plan->plan_hash != plan_hash) {
+			record_change(plans, plan, check, text); // takes the old plan
+			plan->plan = text;
+			plan->plan_hash = plan_hash;
+			text = NULL;
+		}
+		if (plan) plan->generation = check->generation;
+		sqlite3_mutex_leave(mutex);
+		sqlite3_free(text);
+		check_free(check);
+	}
+}
+
+static char* copy_utf8(RXIARG arg) {
+	REBSER *ser = utf8_string(arg);
+	return sqlite3_mprintf("%.*s", (int)SERIES_TAIL(ser), SERIES_TEXT(ser));
+}
+
+// Loads remembered plans from the block: [fingerprint plan ...]. They are
+// compared with the first plan of each statement (main thread only).
+int plans_load(SQLITE_PLANS *plans, sqlite3_mutex *mutex, REBSER *blk, REBCNT index) {
+	PLAN *plan;
+	RXIARG text, arg;
+	char *sql, *fingerprint, *lines;
+	u32 hash = 0;
+	int rc = SQLITE_OK;
+
+	for (; index + 1 < SERIES_TAIL(blk); index += 2) {
+		if (RXT_STRING != RL_GET_VALUE_RESOLVED(blk, index, &text)
+		 || RXT_STRING != RL_GET_VALUE_RESOLVED(blk, index + 1, &arg)) return SQLITE_MISUSE;
+		// normalized again, the fingerprint may be written by hand
+		fingerprint = NULL;
+		if ((sql = copy_utf8(text))) {
+			fingerprint = fingerprint_of(sql, &hash);
+			sqlite3_free(sql);
+		}
+		lines = copy_utf8(arg);
+		if (!sql || !fingerprint || !lines) {
+			sqlite3_free(fingerprint);
+			sqlite3_free(lines);
+			return SQLITE_NOMEM;
+		}
+
+		sqlite3_mutex_enter(mutex);
+		plan = find_plan(plans, hash);
+		if (!plan && plans->count < PLANS_SIZE) {
+			plan = &plans->plans[plans->count++];
+			plan->hash = hash;
+			plan->fingerprint = fingerprint;
+			fingerprint = NULL;
+		}
+		if (plan) {
+			sqlite3_free(plan->plan);
+			plan->plan = lines;
+			plan->plan_hash = sql_hash(lines);
+			plan->generation = 0;
+			lines = NULL;
+		}
+		else rc = SQLITE_FULL;
+		sqlite3_mutex_leave(mutex);
+		sqlite3_free(fingerprint);
+		sqlite3_free(lines);
+	}
+	return rc;
+}
+
+static void append_string(REBSER *blk, const char *text) {
+	RXIARG arg;
+	if (!text) text = "";
+	arg.series = RL_DECODE_UTF_STRING((REBYTE*)text, (REBCNT)strlen(text), 8, 0, 0);
+	arg.index  = 0;
+	RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_STRING);
+}
+
+// Appends remembered plans as: fingerprint plan (main thread only).
+void plans_read(SQLITE_PLANS *plans, sqlite3 *db, REBSER *blk) {
+	sqlite3_mutex *mutex = sqlite3_db_mutex(db);
+	char **texts;
+	u32 count, i;
+
+	plans_check(plans, db);
+	sqlite3_mutex_enter(mutex);
+	count = plans->count;
+	texts = count ? malloc(2 * count * sizeof(char*)) : NULL;
+	for (i = 0; texts && i < count; i++) {
+		texts[2 * i]     = sqlite3_mprintf("%s", plans->plans[i].fingerprint);
+		texts[2 * i + 1] = sqlite3_mprintf("%s", plans->plans[i].plan);
+	}
+	sqlite3_mutex_leave(mutex);
+
+	for (i = 0; texts && i < 2 * count; i++) {
+		append_string(blk, texts[i]);
+		sqlite3_free(texts[i]);
+	}
+	free(texts);
+}
+
+// Appends a block for each detected change and removes them (main thread only).
+int plans_drain(SQLITE_PLANS *plans, sqlite3 *db, REBSER *blk) {
+	sqlite3_mutex *mutex = sqlite3_db_mutex(db);
+	PLAN_CHANGE *changes, *change;
+	REBSER *entry;
+	RXIARG arg;
+	int count, i;
+
+	plans_check(plans, db);
+	sqlite3_mutex_enter(mutex);
+	count = (int)(plans->changes_written - plans->changes_taken);
+	changes = count ? malloc(count * sizeof(PLAN_CHANGE)) : NULL;
+	if (changes) {
+		// moved out, so no Rebol value is made under the mutex
+		for (i = 0; i < count; i++) {
+			change = &plans->changes[(plans->changes_taken + i) % PLAN_CHANGES_SIZE];
+			changes[i] = *change;
+			CLEARS(change);
+		}
+		plans->changes_taken = plans->changes_written;
+	}
+	else count = 0;
+	sqlite3_mutex_leave(mutex);
+
+	for (i = 0; i < count; i++) {
+		change = &changes[i];
+		entry = RL_MAKE_BLOCK(10);
+		append_text (entry, "fingerprint", change->fingerprint);
+		append_text (entry, "sql",         change->sql);
+		append_field(entry, "time",        change->time, RXT_INTEGER);
+		append_text (entry, "old-plan",    change->old_plan);
+		append_text (entry, "new-plan",    change->new_plan);
+		arg.series = entry;
+		arg.index  = 0;
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_BLOCK);
+		change_free(change);
+	}
+	free(changes);
+	return count;
+}
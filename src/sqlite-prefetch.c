@@ -0,0 +1,131 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Prefetch pipeline of a read-only statement (see the `prefetch` command).
+//
+// A helper thread steps the statement ahead and stores rows of the next batch
+// into one of two raw buffers, while rows of the other one are converted to
+// Rebol values by `step`. So the B-tree traversal overlaps with processing of
+// the previous batch on the Rebol side.
+
+#include "sqlite-rebol-extension.h"
+
+static void prefetch_main(void *data) {
+	SQLITE_PREFETCH *pf = (SQLITE_PREFETCH*)data;
+	SQLITE_BATCH *batch;
+	int n, rc = SQLITE_ROW;
+
+	lock_enter(pf->lock);
+	while (rc == SQLITE_ROW && !pf->stop) {
+		batch = &pf->batch[pf->fill];
+		if (batch->full) {
+			lock_wait(pf->lock);
+			continue;
+		}
+		lock_leave(pf->lock);
+
+		rows_clear(&batch->rows);
+		batch->pos = 0;
+		for (n = 0; n < pf->size && !pf->stop; n++) {
+			rc = stmt_step(&batch->steps, pf->stmt);
+			if (rc != SQLITE_ROW) break;
+			if (SQLITE_OK != rows_append(&batch->rows, pf->stmt)) {
+				rc = SQLITE_NOMEM;
+				break;
+			}
+		}
+
+		lock_enter(pf->lock);
+		batch->rc = rc;
+		batch->full = TRUE;
+		pf->fill ^= 1;
+		lock_notify(pf->lock);
+	}
+	lock_leave(pf->lock);
+}
+
+static SQLITE_PREFETCH* prefetch_start(SQLITE_STMT *ctxStmt) {
+	SQLITE_PREFETCH *pf = calloc(1, sizeof(SQLITE_PREFETCH));
+	if (!pf) return NULL;
+	pf->stmt = ctxStmt->stmt;
+	pf->ctxStmt = ctxStmt;
+	pf->size = ctxStmt->prefetch_size;
+	pf->lock = lock_new();
+	if (pf->lock) pf->thread = thread_start(prefetch_main, pf);
+	if (!pf->thread) {
+		if (pf->lock) lock_free(pf->lock);
+		free(pf);
+		return NULL;
+	}
+	ctxStmt->prefetch = pf;
+	return pf;
+}
+
+// Stops the helper thread. Rows which were fetched, but not taken are dropped.
+void prefetch_stop(SQLITE_STMT *ctxStmt) {
+	SQLITE_PREFETCH *pf = ctxStmt->prefetch;
+	if (!pf) return;
+
+	lock_enter(pf->lock);
+	pf->stop = TRUE;
+	lock_notify(pf->lock);
+	lock_leave(pf->lock);
+	thread_join(pf->thread);
+	// statistics of batches which were not returned to the helper
+	steps_add(&ctxStmt->steps, &pf->batch[0].steps);
+	steps_add(&ctxStmt->steps, &pf->batch[1].steps);
+
+	lock_free(pf->lock);
+	rows_free(&pf->batch[0].rows);
+	rows_free(&pf->batch[1].rows);
+	free(pf);
+	ctxStmt->prefetch = NULL;
+}
+
+// Takes up to `maxRows` rows (0 = all) from the prefetched batches, starting
+// the helper thread when needed. Returns SQLITE_ROW when there may be more
+// rows, SQLITE_DONE at the end of the result or an error code.
+// The block is NULL, when there were no more rows.
+int prefetch_step(SQLITE_STMT *ctxStmt, i64 maxRows, REBSER **blk, SQLITE_MADE *made) {
+	SQLITE_PREFETCH *pf = ctxStmt->prefetch;
+	SQLITE_BATCH *batch;
+	i64 rows = 0;
+	int rc = SQLITE_ROW;
+
+	*blk = NULL;
+	if (!pf && !(pf = prefetch_start(ctxStmt))) return SQLITE_NOMEM;
+
+	while (rc == SQLITE_ROW && (!maxRows || rows < maxRows)) {
+		batch = &pf->batch[pf->take];
+		lock_enter(pf->lock);
+		while (!batch->full) lock_wait(pf->lock);
+		lock_leave(pf->lock);
+
+		if (batch->rc != SQLITE_ROW && batch->rc != SQLITE_DONE) {
+			rc = batch->rc;
+			break;
+		}
+		if (batch->pos < batch->rows.used) {
+			if (!*blk) *blk = RL_MAKE_BLOCK(batch->rows.columns * ((maxRows && maxRows < 1000) ? maxRows : 1000));
+			rows += rows_convert(&batch->rows, &batch->pos, maxRows ? maxRows - rows : -1, *blk, made);
+			if (batch->pos < batch->rows.used) break; // the rest is used by the next call
+		}
+		rc = batch->rc;
+		// return the empty batch to the helper
+		lock_enter(pf->lock);
+		steps_add(&ctxStmt->steps, &batch->steps);
+		batch->full = FALSE;
+		pf->take ^= 1;
+		lock_notify(pf->lock);
+		lock_leave(pf->lock);
+	}
+	if (rc != SQLITE_ROW) prefetch_stop(ctxStmt); // the helper is finished
+	return rc;
+}
@@ -0,0 +1,101 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Statistics of extension commands measured in RX_Call and counting of Rebol
+// series made for results of queries (main thread only).
+//
+// Series are counted where the values of a result are made (see series_made),
+// so statements producing large results (and GC pauses) can be found using
+// `info/of`, and commands making them using `command-stats`.
+
+#include "sqlite-rebol-extension.h"
+#include <string.h>
+
+typedef struct command_stats {
+	i64 calls;
+	i64 total;  // ns
+	i64 max;
+	i64 series; // made for results by the command
+	i64 bytes;
+} COMMAND_STATS;
+
+SQLITE_MADE command_made; // by the current command
+
+static COMMAND_STATS command_stats[EXT_SQLITE_COMMANDS];
+
+static i64 series_bytes(REBSER *ser) {
+	return (i64)SERIES_REST(ser) * SERIES_WIDE(ser);
+}
+
+// Starts or stops (dropping collected statistics) the statistics of commands.
+void command_stats_start(REBOOL on) {
+	if (on == !!(call_flags & TIMING_STATS)) return;
+	memset(command_stats, 0, sizeof(command_stats));
+	if (on) call_flags |= TIMING_STATS;
+	else call_flags &= ~TIMING_STATS;
+}
+
+void command_finished(int cmd, i64 time, SQLITE_MADE *made) {
+	COMMAND_STATS *stats = &command_stats[cmd];
+	stats->calls++;
+	stats->total += time;
+	if (time > stats->max) stats->max = time;
+	stats->series += made->series;
+	stats->bytes  += made->bytes;
+}
+
+// Appends statistics of called commands as: name [calls total max series bytes].
+void command_stats_read(REBSER *blk, REBOOL reset) {
+	COMMAND_STATS copy[EXT_SQLITE_COMMANDS];
+	REBSER *entry;
+	RXIARG arg;
+	int cmd;
+
+	memcpy(copy, command_stats, sizeof(copy));
+	if (reset) memset(command_stats, 0, sizeof(command_stats));
+	for (cmd = 0; cmd < EXT_SQLITE_COMMANDS; cmd++) {
+		if (!copy[cmd].calls) continue;
+		entry = RL_MAKE_BLOCK(10);
+		append_field(entry, "calls",  copy[cmd].calls,  RXT_INTEGER);
+		append_field(entry, "total",  copy[cmd].total,  RXT_TIME);
+		append_field(entry, "max",    copy[cmd].max,    RXT_TIME);
+		append_field(entry, "series", copy[cmd].series, RXT_INTEGER);
+		append_field(entry, "bytes",  copy[cmd].bytes,  RXT_INTEGER);
+		arg.int32a = RL_MAP_WORD((REBYTE*)Command_Name[cmd]);
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_WORD);
+		arg.series = entry;
+		arg.index  = 0;
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_BLOCK);
+	}
+}
+
+static void account(SQLITE_RESULT_MEMORY *memory, i64 series, i64 bytes) {
+	memory->results++;
+	memory->series += series;
+	memory->bytes  += bytes;
+	if (bytes > memory->peak) memory->peak = bytes;
+}
+
+// Counts a series made for a result. A block is counted when it is complete,
+// so its capacity includes growth made by RL_SET_VALUE.
+void series_made(SQLITE_MADE *made, REBSER *ser) {
+	if (!ser) return;
+	made->series++;
+	made->bytes += series_bytes(ser);
+}
+
+// Accounts series made for one result to the statement (if any), to its
+// connection (if known) and to the current command.
+void result_made(SQLITE_CONTEXT *ctx, SQLITE_STMT *ctxStmt, SQLITE_MADE *made) {
+	if (ctxStmt) account(&ctxStmt->memory, made->series, made->bytes);
+	if (ctx) account(&ctx->memory, made->series, made->bytes);
+	command_made.series += made->series;
+	command_made.bytes  += made->bytes;
+}
@@ -0,0 +1,73 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Pool of read-only connections to the database file of a connection.
+// The connections are opened on demand and kept until the connection is
+// closed. Each one is used by a single thread at once, so no mutexes.
+//
+// The readers wait for locks like the owning connection: each one has its own
+// copy of the busy policy (with its own wait state), but without the Rebol
+// callback, which cannot be called from their threads.
+
+#include "sqlite-rebol-extension.h"
+
+// Applies the current busy policy of the owning connection to the reader.
+static void reader_busy(SQLITE_CONTEXT *ctx, int i) {
+	SQLITE_BUSY_POLICY *busy = &ctx->readers_busy[i];
+	CLEARS(busy);
+	busy->timeout   = ctx->busy.timeout;
+	busy->delay_min = ctx->busy.delay_min;
+	busy->delay_max = ctx->busy.delay_max;
+	sqlite3_busy_handler(ctx->readers[i], busy->timeout ? busy_handler : NULL, busy);
+}
+
+// Makes sure there are at least `count` read connections, which use the
+// current busy policy.
+int readers_reserve(SQLITE_CONTEXT *ctx, int count) {
+	const char *file;
+	sqlite3 **readers;
+	SQLITE_BUSY_POLICY *busy;
+	int i, rc = SQLITE_OK;
+
+	if (count > ctx->readers_count) {
+		file = sqlite3_db_filename(ctx->db, "main");
+		if (!file || !*file) return SQLITE_CANTOPEN; // in-memory or temporary database
+
+		readers = realloc(ctx->readers, count * sizeof(sqlite3*));
+		if (!readers) return SQLITE_NOMEM;
+		ctx->readers = readers;
+		busy = realloc(ctx->readers_busy, count * sizeof(SQLITE_BUSY_POLICY));
+		if (!busy) return SQLITE_NOMEM;
+		ctx->readers_busy = busy;
+
+		while (ctx->readers_count < count) {
+			rc = sqlite3_open_v2(file, &readers[ctx->readers_count],
+				SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, ctx->vfs);
+			if (rc != SQLITE_OK) {
+				sqlite3_close(readers[ctx->readers_count]);
+				break;
+			}
+			ctx->readers_count++;
+		}
+	}
+	// the policy may be changed since the last use
+	for (i = 0; i < ctx->readers_count; i++) reader_busy(ctx, i);
+	return rc;
+}
+
+void readers_close(SQLITE_CONTEXT *ctx) {
+	while (ctx->readers_count > 0) {
+		sqlite3_close(ctx->readers[--ctx->readers_count]);
+	}
+	free(ctx->readers);
+	free(ctx->readers_busy);
+	ctx->readers = NULL;
+	ctx->readers_busy = NULL;
+}
@@ -19,11 +19,19 @@ u32*   words_sqlite_cmd;
 u32*   words_sqlite_arg;
 REBCNT Handle_SQLiteDB;
 REBCNT Handle_SQLiteSTMT;
+REBCNT Handle_SQLiteSNAPSHOT;
+REBCNT Handle_SQLiteGC;
 
-REBDEC doubles[DOUBLE_BUFFER_SIZE];
-RXIARG arg[ARG_BUFFER_SIZE];
+int    release_on_recycle = 0; // bytes released when the GC collects the sentinel
+int    threading_mode = 0;     // SQLITE_CONFIG_SINGLETHREAD/MULTITHREAD/SERIALIZED or 0 (build default)
+int    call_flags = 0;         // TIMING_* and CALL_* flags (see RX_Call)
+THREAD_LOCAL i64 command_bind_ns; // time of binding parameters in the current command
+THREAD_LOCAL i64 command_step_ns; // time of stepping statements in the current command
+static REBOOL gc_sentinel = FALSE;
 
-char* error_buffer[255]; // temporary buffer used to pass an exception messages to Rebol side
+// Temporary buffer used to pass an exception message to Rebol side. Rebol copies
+// the message right after the command returns, so one buffer per thread is enough.
+THREAD_LOCAL char error_buffer[255];
 
 extern MyCommandPointer Command[];
 //============================================================================//
@@ -33,15 +41,47 @@ static const char* init_block = EXT_SQLITE_INIT_CODE;
 void* releaseSQLiteDBHandle(void* hndl) {
 	SQLITE_CONTEXT *ctx = (SQLITE_CONTEXT*)hndl;
 	debug_print("releasing sqlite db: %p\n", ctx->db);
+	if(ctx->worker) {
+		worker_stop(ctx->worker);
+		worker_release(ctx->worker);
+	}
+	readers_close(ctx);
+	checkpointer_stop(ctx);
 	if(ctx->db) sqlite3_close((sqlite3*)ctx->db);
+	trace_release(ctx);
 	return NULL;
 }
 void* releaseSQLiteSTMTHandle(void* hndl) {
 	SQLITE_STMT *ctx = (SQLITE_STMT*)hndl;
 	debug_print("releasing sqlite stmt: %p\n", ctx->stmt);
+	prefetch_stop(ctx);
+	if(ctx->worker) {
+		worker_wait_stmt(ctx->worker, ctx);
+		worker_release(ctx->worker);
+	}
 	if(ctx->stmt) sqlite3_finalize((sqlite3_stmt*)ctx->stmt);
 	return NULL;
 }
+void* releaseSQLiteSNAPSHOTHandle(void* hndl) {
+	SQLITE_SNAPSHOT *snap = (SQLITE_SNAPSHOT*)hndl;
+	if(snap->snapshot) snapshot_free(snap->snapshot);
+	return NULL;
+}
+
+// The sentinel is an unreferenced handle, so it is collected by the next
+// recycle. Releasing memory does not touch Rebol, so it is safe in the GC.
+void* releaseSQLiteGCHandle(void* hndl) {
+	gc_sentinel = FALSE;
+	if (release_on_recycle) {
+		debug_print("releasing sqlite memory on recycle: %i\n", release_on_recycle);
+		sqlite3_release_memory(release_on_recycle);
+	}
+	return NULL;
+}
+void arm_gc_sentinel(void) {
+	// re-arm the recycle sentinel (it cannot be made inside the GC)
+	if (!gc_sentinel) gc_sentinel = (RL_MAKE_HANDLE_CONTEXT(Handle_SQLiteGC) != NULL);
+}
 
 
 RXIEXT const char *RX_Init(int opts, RL_LIB *lib) {
@@ -60,13 +100,47 @@ RXIEXT const char *RX_Init(int opts, RL_LIB *lib) {
     }
 	Handle_SQLiteDB   = RL_REGISTER_HANDLE((REBYTE*)"sqlite-db", sizeof(SQLITE_CONTEXT), releaseSQLiteDBHandle);
 	Handle_SQLiteSTMT = RL_REGISTER_HANDLE((REBYTE*)"sqlite-stmt", sizeof(SQLITE_STMT), releaseSQLiteSTMTHandle);
-	sqlite3_initialize();
+	Handle_SQLiteSNAPSHOT = RL_REGISTER_HANDLE((REBYTE*)"sqlite-snapshot", sizeof(SQLITE_SNAPSHOT), releaseSQLiteSNAPSHOTHandle);
+	Handle_SQLiteGC   = RL_REGISTER_HANDLE((REBYTE*)"sqlite-gc", sizeof(int), releaseSQLiteGCHandle);
+	// The library is not initialized here, so it may be configured using
+	// `initialize/with`. SQLite initializes itself on the first use anyway.
+	// The error log must be set before that (used by the index advisor).
+	sqlite3_config(SQLITE_CONFIG_LOG, advisor_log, NULL);
     return init_block;
 }
 
 
+// Calls the command when some of call_flags is set. When timed, measures also
+// how much of its time was spent binding parameters and stepping statements
+// (the rest is mostly conversion of Rebol values).
+static int flagged_call(int cmd, RXIFRM *frm, void *ctx) {
+	int flags = call_flags, ret;
+	i64 start = 0, end;
+
+	if (flags & CALL_RECYCLE) arm_gc_sentinel();
+	if (flags & TIMING) {
+		command_bind_ns = command_step_ns = 0;
+		CLEARS(&command_made);
+		start = monotonic_ns();
+	}
+	ret = Command[cmd](frm, ctx);
+	if (call_flags & CALL_DEADLINE) deadline_clear();
+	if (flags & TIMING) {
+		end = monotonic_ns();
+		// the command may have stopped the timing
+		if (call_flags & TIMING_EXPORT) export_command(Command_Name[cmd], start, end);
+		if (call_flags & TIMING_STATS)  command_finished(cmd, end - start, &command_made);
+	}
+	return ret;
+}
+
 RXIEXT int RX_Call(int cmd, RXIFRM *frm, void *ctx) {
-	return Command[cmd](frm, ctx);
+	int ret;
+	if (call_flags) return flagged_call(cmd, frm, ctx);
+	ret = Command[cmd](frm, ctx);
+	// a time limit is used only by a single command
+	if (call_flags & CALL_DEADLINE) deadline_clear();
+	return ret;
 }
 
 RXIEXT int RX_Quit(int opts) {
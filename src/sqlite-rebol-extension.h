@@ -19,59 +19,169 @@
 
 extern REBCNT Handle_SQLiteDB;
 extern REBCNT Handle_SQLiteSTMT;
+extern REBCNT Handle_SQLiteSNAPSHOT;
 
-extern char* error_buffer[255];
+extern THREAD_LOCAL char error_buffer[255];
 
 
 enum ext_commands {
+	CMD_SQLITE_INIT_WORDS,
 	CMD_SQLITE_INFO,
+	CMD_SQLITE_COMMAND_STATS,
 	CMD_SQLITE_OPEN,
 	CMD_SQLITE_EXEC,
 	CMD_SQLITE_EVAL,
+	CMD_SQLITE_FAN_OUT,
 	CMD_SQLITE_LAST_INSERT_ID,
 	CMD_SQLITE_FINALIZE,
 	CMD_SQLITE_TRACE,
+	CMD_SQLITE_TRACE_EVENTS,
+	CMD_SQLITE_TRACE_EXPORT,
+	CMD_SQLITE_QUERY_STATS,
+	CMD_SQLITE_INDEX_ADVISOR,
+	CMD_SQLITE_INDEX_ADVICE,
+	CMD_SQLITE_PLAN_WATCH,
+	CMD_SQLITE_PLAN_CHANGES,
+	CMD_SQLITE_SCAN_STATUS,
+	CMD_SQLITE_SLOW_LOG,
+	CMD_SQLITE_BUSY,
+	CMD_SQLITE_CONTENTION,
+	CMD_SQLITE_CHECKPOINT,
+	CMD_SQLITE_AUTO_CHECKPOINT,
+	CMD_SQLITE_SNAPSHOT,
+	CMD_SQLITE_SNAPSHOT_OPEN,
+	CMD_SQLITE_SNAPSHOT_COMPARE,
+	CMD_SQLITE_SNAPSHOT_FREE,
+	CMD_SQLITE_GROUP_COMMIT,
+	CMD_SQLITE_TIME_LIMIT,
+	CMD_SQLITE_INTERRUPT,
 	CMD_SQLITE_PREPARE,
 	CMD_SQLITE_RESET,
 	CMD_SQLITE_STEP,
+	CMD_SQLITE_PREFETCH,
+	CMD_SQLITE_RESULT,
 	CMD_SQLITE_CLOSE,
 	CMD_SQLITE_COLUMNS,
 	CMD_SQLITE_INITIALIZE,
 	CMD_SQLITE_SHUTDOWN,
+	CMD_SQLITE_SOFT_HEAP_LIMIT,
+	CMD_SQLITE_HARD_HEAP_LIMIT,
+	CMD_SQLITE_RELEASE_MEMORY,
+};
+
+enum ext_arg_words {W_ARG_0,
+	W_ARG_MEMSTATUS,
+	W_ARG_PAGE_CACHE,
+	W_ARG_LOOKASIDE,
+	W_ARG_ALLOCATOR,
+	W_ARG_POOL,
+	W_ARG_SYSTEM,
+	W_ARG_THREADING,
+	W_ARG_SINGLE_THREAD,
+	W_ARG_MULTI_THREAD,
+	W_ARG_SERIALIZED,
+	W_ARG_TIMEOUT,
+	W_ARG_BACKOFF,
+	W_ARG_CALLBACK,
+	W_ARG_PASSIVE,
+	W_ARG_FULL,
+	W_ARG_RESTART,
+	W_ARG_TRUNCATE,
 };
 
 
+int cmd_sqlite_init_words(RXIFRM *frm, void *ctx);
 int cmd_sqlite_info(RXIFRM *frm, void *ctx);
+int cmd_sqlite_command_stats(RXIFRM *frm, void *ctx);
 int cmd_sqlite_open(RXIFRM *frm, void *ctx);
 int cmd_sqlite_exec(RXIFRM *frm, void *ctx);
 int cmd_sqlite_eval(RXIFRM *frm, void *ctx);
+int cmd_sqlite_fan_out(RXIFRM *frm, void *ctx);
 int cmd_sqlite_last_insert_id(RXIFRM *frm, void *ctx);
 int cmd_sqlite_finalize(RXIFRM *frm, void *ctx);
 int cmd_sqlite_trace(RXIFRM *frm, void *ctx);
+int cmd_sqlite_trace_events(RXIFRM *frm, void *ctx);
+int cmd_sqlite_trace_export(RXIFRM *frm, void *ctx);
+int cmd_sqlite_query_stats(RXIFRM *frm, void *ctx);
+int cmd_sqlite_index_advisor(RXIFRM *frm, void *ctx);
+int cmd_sqlite_index_advice(RXIFRM *frm, void *ctx);
+int cmd_sqlite_plan_watch(RXIFRM *frm, void *ctx);
+int cmd_sqlite_plan_changes(RXIFRM *frm, void *ctx);
+int cmd_sqlite_scan_status(RXIFRM *frm, void *ctx);
+int cmd_sqlite_slow_log(RXIFRM *frm, void *ctx);
+int cmd_sqlite_busy(RXIFRM *frm, void *ctx);
+int cmd_sqlite_contention(RXIFRM *frm, void *ctx);
+int cmd_sqlite_checkpoint(RXIFRM *frm, void *ctx);
+int cmd_sqlite_auto_checkpoint(RXIFRM *frm, void *ctx);
+int cmd_sqlite_snapshot(RXIFRM *frm, void *ctx);
+int cmd_sqlite_snapshot_open(RXIFRM *frm, void *ctx);
+int cmd_sqlite_snapshot_compare(RXIFRM *frm, void *ctx);
+int cmd_sqlite_snapshot_free(RXIFRM *frm, void *ctx);
+int cmd_sqlite_group_commit(RXIFRM *frm, void *ctx);
+int cmd_sqlite_time_limit(RXIFRM *frm, void *ctx);
+int cmd_sqlite_interrupt(RXIFRM *frm, void *ctx);
 int cmd_sqlite_prepare(RXIFRM *frm, void *ctx);
 int cmd_sqlite_reset(RXIFRM *frm, void *ctx);
 int cmd_sqlite_step(RXIFRM *frm, void *ctx);
+int cmd_sqlite_prefetch(RXIFRM *frm, void *ctx);
+int cmd_sqlite_result(RXIFRM *frm, void *ctx);
 int cmd_sqlite_close(RXIFRM *frm, void *ctx);
 int cmd_sqlite_columns(RXIFRM *frm, void *ctx);
 int cmd_sqlite_initialize(RXIFRM *frm, void *ctx);
 int cmd_sqlite_shutdown(RXIFRM *frm, void *ctx);
+int cmd_sqlite_soft_heap_limit(RXIFRM *frm, void *ctx);
+int cmd_sqlite_hard_heap_limit(RXIFRM *frm, void *ctx);
+int cmd_sqlite_release_memory(RXIFRM *frm, void *ctx);
+
+#define EXT_SQLITE_COMMANDS 42
 
 typedef int (*MyCommandPointer)(RXIFRM *frm, void *ctx);
+extern const char* Command_Name[];
 
 #define EXT_SQLITE_INIT_CODE \
-	"REBOL [Title: \"Rebol SQLite Extension\" Name: sqlite Type: module Exports: [] Version: 3.51.2.1 Needs:   3.13.1 Author: Oldes Date: 25-Feb-2026/11:41:56 License: MIT Url: https://github.com/Siskin-framework/Rebol-SQLite]\n"\
-	"info: command [\"Returns info about SQLite extension library\" /of handle [handle!] \"SQLite Extension handle\"]\n"\
-	"open: command [\"Opens a new database connection\" file [file!]]\n"\
+	"REBOL [Title: \"Rebol SQLite Extension\" Name: sqlite Type: module Exports: [] Version: 3.51.2.1 Needs:   3.13.1 Author: Oldes Date: 18-Oct-2026/22:15:19 License: MIT Url: https://github.com/Siskin-framework/Rebol-SQLite]\n"\
+	"init-words: command [cmd-words [block!] arg-words [block!]]\n"\
+	"info: command [{Returns versions and memory statistics of the library, or statistics of the connection or statement} /of handle [handle!] \"sqlite-db or sqlite-stmt\" /reset {Clears the counters and high-water marks after reading them}]\n"\
+	"command-stats: command [{Counts calls, time and Rebol series made for results by each extension command, returns them as: [name [calls total max series bytes] ...]} mode [logic! none!] {true to start, false to stop and drop the statistics, none only returns them} /reset \"Clears the statistics after reading them\"]\n"\
+	"open: command [\"Opens a new database connection\" file [file!] /compressed \"Pages are transparently compressed (no WAL mode)\" /shared {Uses the shared cache, table lock conflicts wait for the busy timeout}]\n"\
 	"exec: command [{Runs zero or more semicolon-separate SQL statements} db [handle!] \"sqlite-db\" sql [string!] \"statements\"]\n"\
-	"eval: command [\"Evaluates SQL statement with optional paramaters\" db [handle!] \"sqlite-db\" query [string! block! handle!] {single statement, a single statement with parameters or a prepared statement}]\n"\
+	"eval: command [\"Evaluates SQL statement with optional paramaters\" db [handle!] \"sqlite-db\" query [string! block! handle!] {single statement, a single statement with parameters or a prepared statement} /async {Evaluates on the connection's worker thread and returns the job id (see result)} /timeout {Fails with the Query timed out! error when not finished in time} ms [integer!] {Overrides the time limit of the connection or statement (0 = no limit)}]\n"\
+	"fan-out: command [{Evaluates a read-only query over partitions of a key range at once on pooled read connections} db [handle!] \"sqlite-db\" query [string!] {SELECT with lower and upper bound parameters, like: WHERE rowid >= ?1 AND rowid < ?2} low [integer!] \"Lower bound of the whole range\" high [integer!] \"Upper bound of the whole range (exclusive)\" parts [integer!] \"Number of partitions evaluated in parallel (1-64)\" /merge {Merges sorted results of the partitions, else the results are concatenated} column [integer!] {Sort column (1-based, negative for descending order), text is compared as with the BINARY collation}]\n"\
 	"last-insert-id: command [{Returns the rowid of the most recent successful INSERT into a rowid table or virtual table on database connection} db [handle!] \"sqlite-db\"]\n"\
 	"finalize: command [\"Deletes prepared statement\" stmt [handle!] \"sqlite-stmt\"]\n"\
-	"trace: command [\"Traces debug output\" db [handle!] \"sqlite-db\" mask [integer!]]\n"\
+	"trace: command [{Records trace events of the connection into a ring buffer (see trace-events)} db [handle!] \"sqlite-db\" mask [integer!] {1 = statements, 2 = profile, 4 = rows, 8 = close, 0 stops tracing} /buffer {Sets capacity of the buffer (default 1024), recorded events are dropped} events [integer!] \"When full, the oldest event is overwritten\" /expanded {Records SQL with bound parameters (slower), else the statement's text}]\n"\
+	"trace-events: command [{Returns and removes recorded trace events as a flat block of: type time-ns duration hash sql} db [handle!] \"sqlite-db\"]\n"\
+	"trace-export: command [{Writes timings of statements and of extension commands into a file in the Chrome trace event format (one track per connection)} db [handle!] \"sqlite-db\" file [file! none!] {Shared by all exporting connections, none stops the export of this connection}]\n"\
+	"query-stats: command [{Aggregates statistics of queries by their fingerprint (SQL without literals and parameter values), returns them} db [handle!] \"sqlite-db\" mode [logic! none!] {true to start, false to stop and drop the statistics, none only returns them} /reset \"Clears the statistics after reading them\"]\n"\
+	"index-advisor: command [{Collects statements which use automatic indexes or do many full-scan steps, for the index-advice command} db [handle!] \"sqlite-db\" threshold [integer! none!] {Full-scan steps of one run (0 = only automatic indexes), none stops and drops collected statements}]\n"\
+	"index-advice: command [{Analyzes collected statements, returns suggested indexes with VM steps saved in one run (none for in-memory databases), and removes the statements} db [handle!] \"sqlite-db\"]\n"\
+	"plan-watch: command [{Remembers query plans of statements to detect their changes, returns remembered plans as: [fingerprint plan ...]} db [handle!] \"sqlite-db\" mode [logic! block! none!] {true to start, false to stop and drop the plans, block to load plans, none only returns them}]\n"\
+	"plan-changes: command [{Returns and removes detected changes of query plans (each with the old and the new plan)} db [handle!] \"sqlite-db\"]\n"\
+	"scan-status: command [{Returns statistics of each loop of the statement's query plan (requires SQLITE_ENABLE_STMT_SCANSTATUS)} stmt [handle!] \"sqlite-stmt\" /reset \"Clears the statistics after reading them\"]\n"\
+	"slow-log: command [{Logs queries running longer than the threshold, returns and removes logged ones (each with SQL, counters and query plan)} db [handle!] \"sqlite-db\" threshold [integer! none!] \"ms, 0 = no logging, none only returns the log\"]\n"\
+	"busy: command [{Sets how the connection waits when the database is locked by another connection} db [handle!] \"sqlite-db\" policy [integer! block! none!] {Timeout in ms, [timeout ms backoff min-ms max-ms callback object 'function] (backoff and callback need the timeout, used by helper threads) or none to fail at once}]\n"\
+	"contention: command [{Returns lock contention statistics of the connection} db [handle!] \"sqlite-db\" /reset \"Clears the statistics\"]\n"\
+	"checkpoint: command [{Checkpoints the WAL, returns frames in the log and frames checkpointed} db [handle!] \"sqlite-db\" /mode {Default is passive, which does not wait for readers or writers} name [word!] \"passive, full, restart or truncate\"]\n"\
+	"auto-checkpoint: command [{Checkpoints the WAL after commits when it has the given number of frames, returns statistics} db [handle!] \"sqlite-db\" frames [integer! none!] {0 = no checkpoints, none only returns the statistics} /background {Checkpoints on a helper thread using its own connection, so commits are not delayed}]\n"\
+	"snapshot: command [{Returns a snapshot of the state seen by the current read transaction (or of the latest state) of a WAL database} db [handle!] \"sqlite-db\"]\n"\
+	"snapshot-open: command [{Starts a read transaction at the snapshot, which is ended by COMMIT} db [handle!] \"sqlite-db (the same database file)\" snap [handle!] \"sqlite-snapshot\"]\n"\
+	"snapshot-compare: command [{Returns a negative number if the first snapshot is older than the second one, positive if newer, else 0} snap1 [handle!] \"sqlite-snapshot\" snap2 [handle!] \"sqlite-snapshot\"]\n"\
+	"snapshot-free: command [\"Deletes the snapshot\" snap [handle!] \"sqlite-snapshot\"]\n"\
+	"group-commit: command [{Commits async writes on the connection together in one transaction} db [handle!] \"sqlite-db\" delay [integer!] {Max ms the first write waits for others (0 = each write is committed alone)} writes [integer!] \"Max number of writes in one transaction\"]\n"\
+	"time-limit: command [{Sets the time limit of each query on the connection or of each step of the statement} target [handle!] \"sqlite-db or sqlite-stmt\" ms [integer!] {0 = no limit (statements use the limit of the connection)}]\n"\
+	"interrupt: command [{Stops a query running on the connection (for example an async one)} db [handle!] \"sqlite-db\"]\n"\
 	"prepare: command [\"Prepares SQL statement\" db [handle!] \"sqlite-db\" sql [string!] \"statement\"]\n"\
 	"reset: command [\"Resets prepared statement\" stmt [handle!] \"sqlite-stmt\"]\n"\
-	"step: command [\"Executes prepared statement\" stmt [handle!] \"sqlite-stmt\" /rows {Multiple times if there is enough rows in the result} count [integer!] /with parameters [block!]]\n"\
+	"step: command [\"Executes prepared statement\" stmt [handle!] \"sqlite-stmt\" /rows {Multiple times if there is enough rows in the result} count [integer!] /with parameters [block!] /async {Steps on the connection's worker thread and returns the job id (see result)}]\n"\
+	"prefetch: command [{Steps the statement ahead on a helper thread, so step/rows only converts already fetched rows} stmt [handle!] \"sqlite-stmt (read-only)\" rows [integer!] \"Rows per batch (two batches are buffered), 0 = off\"]\n"\
+	"result: command [{Returns result of the oldest finished async query (none if there is no one, a step without rows returns an empty block)} db [handle!] \"sqlite-db\" /wait \"Waits for a queued or running query to finish\" ms [integer!] {Max ms to wait (fails with the Async query timed out! error)}]\n"\
 	"close: command [\"Closes a database connection\" db [handle!] \"sqlite-db\"]\n"\
 	"columns: command [\"Returns column names associated with the statement\" stmt [handle!] \"sqlite-stmt\"]\n"\
-	"initialize: command [\"Initializes the SQLite library\"]\n"\
-	"shutdown: command [\"Deallocate any resources that were allocated\"]\n"
+	"initialize: command [\"Initializes the SQLite library\" /with {Configures the library first (not possible after initialization)} config [block!] {[threading single-thread|multi-thread|serialized memstatus logic! page-cache size count lookaside size count allocator pool|system]}]\n"\
+	"shutdown: command [\"Deallocate any resources that were allocated\"]\n"\
+	"soft-heap-limit: command [{Sets the advisory heap limit, returns the previous one} limit [integer!] {Bytes, 0 = no limit, negative value only queries the limit}]\n"\
+	"hard-heap-limit: command [{Sets the heap limit which is never exceeded, returns the previous one} limit [integer!] {Bytes, 0 = no limit, negative value only queries the limit}]\n"\
+	"release-memory: command [{Attempts to free heap memory held by SQLite, returns number of released bytes} target [handle! integer!] {sqlite-db to release its caches or number of bytes to be released globally} /auto {Release the number of bytes after each Rebol recycle (0 = off)}]\n"\
+	"init-words [] [memstatus page-cache lookaside allocator pool system threading single-thread multi-thread serialized timeout backoff callback passive full restart truncate]\n"\
+	"protect/hide 'init-words\n"
 
@@ -0,0 +1,314 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Raw value buffers used to pass data between Rebol and background threads.
+//
+// Rebol series must not be created outside of the interpreter's thread, so
+// values are stored in a plain C buffer as: type byte followed by i64/double
+// or u32 length + bytes (nothing for NULL). Rows collected by a worker are
+// converted to a block later on the main thread, and parameters captured on
+// the main thread are bound by the worker.
+
+#include "sqlite-rebol-extension.h"
+#include <string.h>
+
+static REBYTE* rows_reserve(SQLITE_ROWS *rows, size_t bytes) {
+	REBYTE *data;
+	size_t size;
+	if (rows->used + bytes > rows->size) {
+		size = rows->size ? rows->size * 2 : 1024;
+		while (size < rows->used + bytes) size *= 2;
+		data = realloc(rows->data, size);
+		if (!data) return NULL;
+		rows->data = data;
+		rows->size = size;
+	}
+	data = rows->data + rows->used;
+	rows->used += bytes;
+	return data;
+}
+
+static int rows_put(SQLITE_ROWS *rows, int type, const void *value, u32 bytes) {
+	REBYTE *p;
+	switch (type) {
+	case SQLITE_INTEGER:
+	case SQLITE_FLOAT:
+		if (!(p = rows_reserve(rows, 9))) return SQLITE_NOMEM;
+		*p = (REBYTE)type;
+		memcpy(p + 1, value, 8);
+		break;
+	case SQLITE_TEXT:
+	case SQLITE_BLOB:
+		if (!(p = rows_reserve(rows, 5 + (size_t)bytes))) return SQLITE_NOMEM;
+		*p = (REBYTE)type;
+		memcpy(p + 1, &bytes, 4);
+		if (bytes) memcpy(p + 5, value, bytes);
+		break;
+	default:
+		if (!(p = rows_reserve(rows, 1))) return SQLITE_NOMEM;
+		*p = SQLITE_NULL;
+	}
+	return SQLITE_OK;
+}
+
+// Appends the current row of the statement (may be used on any thread).
+int rows_append(SQLITE_ROWS *rows, sqlite3_stmt *stmt) {
+	int col, rc = SQLITE_OK;
+	i64 i;
+	double d;
+
+	rows->columns = sqlite3_data_count(stmt);
+	for (col = 0; rc == SQLITE_OK && col < rows->columns; col++) {
+		switch (sqlite3_column_type(stmt, col)) {
+		case SQLITE_INTEGER:
+			i = sqlite3_column_int64(stmt, col);
+			rc = rows_put(rows, SQLITE_INTEGER, &i, 8);
+			break;
+		case SQLITE_FLOAT:
+			d = sqlite3_column_double(stmt, col);
+			rc = rows_put(rows, SQLITE_FLOAT, &d, 8);
+			break;
+		case SQLITE_TEXT:
+			rc = rows_put(rows, SQLITE_TEXT, sqlite3_column_text(stmt, col), sqlite3_column_bytes(stmt, col));
+			break;
+		case SQLITE_BLOB:
+			rc = rows_put(rows, SQLITE_BLOB, sqlite3_column_blob(stmt, col), sqlite3_column_bytes(stmt, col));
+			break;
+		default:
+			rc = rows_put(rows, SQLITE_NULL, NULL, 0);
+		}
+	}
+	if (rc == SQLITE_OK) rows->count++;
+	return rc;
+}
+
+// Captures `count` parameter values from the series as one row.
+// Returns SQLITE_MISUSE for a value which cannot be bound.
+int rows_capture(SQLITE_ROWS *rows, REBSER *params, REBCNT index, int count) {
+	REBSER *ser;
+	RXIARG  arg = {0};
+	int col, type, rc = SQLITE_OK;
+	i64 i;
+
+	rows->columns = count;
+	for (col = 0; rc == SQLITE_OK && col < count; col++, index++) {
+		type = RL_GET_VALUE_RESOLVED(params, index, &arg);
+		switch (type) {
+		case RXT_INTEGER:
+			rc = rows_put(rows, SQLITE_INTEGER, &arg.int64, 8);
+			break;
+		case RXT_DECIMAL:
+			rc = rows_put(rows, SQLITE_FLOAT, &arg.dec64, 8);
+			break;
+		case RXT_LOGIC:
+			i = arg.int32a;
+			rc = rows_put(rows, SQLITE_INTEGER, &i, 8);
+			break;
+		case RXT_STRING:
+		case RXT_FILE:
+		case RXT_EMAIL:
+		case RXT_REF:
+		case RXT_URL:
+		case RXT_TAG:
+			ser = (REBSER*)arg.series;
+			if (SERIES_WIDE(ser) > 1) {
+				ser = RL_ENCODE_UTF8_STRING(SERIES_DATA(ser), SERIES_TAIL(ser), TRUE, FALSE);
+				arg.index = 0;
+			}
+			rc = rows_put(rows, SQLITE_TEXT, SERIES_SKIP(ser, arg.index), SERIES_TAIL(ser) - arg.index);
+			break;
+		case RXT_BINARY:
+			ser = (REBSER*)arg.series;
+			rc = rows_put(rows, SQLITE_BLOB, SERIES_SKIP(ser, arg.index), SERIES_TAIL(ser) - arg.index);
+			break;
+		case RXT_VECTOR:
+			ser = (REBSER*)arg.series;
+			rc = rows_put(rows, SQLITE_BLOB, SERIES_DATA(ser), SERIES_TAIL(ser) * VECT_BYTE_SIZE(VECT_TYPE(ser)));
+			break;
+		case RXT_NONE:
+		case RXT_END:
+			rc = rows_put(rows, SQLITE_NULL, NULL, 0);
+			break;
+		default:
+			return SQLITE_MISUSE;
+		}
+	}
+	if (rc == SQLITE_OK) rows->count++;
+	return rc;
+}
+
+// Binds one captured row starting at `*pos` and moves the position past it.
+int rows_bind(SQLITE_ROWS *rows, size_t *pos, sqlite3_stmt *stmt) {
+	REBYTE *p = rows->data + *pos;
+	int col, rc = SQLITE_OK;
+	u32 bytes;
+	i64 i;
+	double d;
+
+	sqlite3_clear_bindings(stmt);
+	for (col = 1; col <= rows->columns; col++) {
+		switch (*p++) {
+		case SQLITE_INTEGER:
+			memcpy(&i, p, 8);
+			p += 8;
+			rc = sqlite3_bind_int64(stmt, col, i);
+			break;
+		case SQLITE_FLOAT:
+			memcpy(&d, p, 8);
+			p += 8;
+			rc = sqlite3_bind_double(stmt, col, d);
+			break;
+		case SQLITE_TEXT:
+			memcpy(&bytes, p, 4);
+			rc = sqlite3_bind_text(stmt, col, (const char*)p + 4, bytes, SQLITE_TRANSIENT);
+			p += 4 + bytes;
+			break;
+		case SQLITE_BLOB:
+			memcpy(&bytes, p, 4);
+			rc = sqlite3_bind_blob(stmt, col, p + 4, bytes, SQLITE_TRANSIENT);
+			p += 4 + bytes;
+			break;
+		default:
+			rc = sqlite3_bind_null(stmt, col);
+		}
+		if (rc != SQLITE_OK) break;
+	}
+	*pos = p - rows->data;
+	return rc;
+}
+
+// Appends up to `max` rows (all when negative) starting at `*pos` to the block
+// and moves the position past them. Returns number of converted rows.
+// Must be used only on the main thread!
+i64 rows_convert(SQLITE_ROWS *rows, size_t *pos, i64 max, REBSER *blk, SQLITE_MADE *made) {
+	REBSER *ser;
+	REBYTE *p, *end;
+	RXIARG  arg;
+	REBCNT  n = SERIES_TAIL(blk);
+	i64     count = 0;
+	u32 bytes;
+	int col, type;
+
+	p   = rows->data + *pos;
+	end = rows->data + rows->used;
+	while (p < end && (max < 0 || count < max)) {
+		for (col = 0; col < rows->columns; col++) {
+			CLEARS(&arg);
+			switch (*p++) {
+			case SQLITE_INTEGER:
+				type = RXT_INTEGER;
+				memcpy(&arg.int64, p, 8);
+				p += 8;
+				break;
+			case SQLITE_FLOAT:
+				type = RXT_DECIMAL;
+				memcpy(&arg.dec64, p, 8);
+				p += 8;
+				break;
+			case SQLITE_TEXT:
+				type = RXT_STRING;
+				memcpy(&bytes, p, 4);
+				arg.series = RL_DECODE_UTF_STRING(p + 4, bytes, 8, 0, 0);
+				if (made) series_made(made, arg.series);
+				p += 4 + bytes;
+				break;
+			case SQLITE_BLOB:
+				type = RXT_BINARY;
+				memcpy(&bytes, p, 4);
+				ser = RL_MAKE_BINARY(bytes);
+				memcpy(SERIES_DATA(ser), p + 4, bytes);
+				SERIES_TAIL(ser) = bytes;
+				arg.series = ser;
+				if (made) series_made(made, ser);
+				p += 4 + bytes;
+				break;
+			default:
+				type = RXT_NONE;
+			}
+			RL_SET_VALUE(blk, n++, arg, type);
+		}
+		count++;
+	}
+	*pos = p - rows->data;
+	return count;
+}
+
+// Converts all collected rows into a flat block (main thread only).
+REBSER* rows_to_block(SQLITE_ROWS *rows, SQLITE_MADE *made) {
+	REBSER *blk = RL_MAKE_BLOCK((REBCNT)(rows->count * rows->columns));
+	size_t pos = 0;
+	rows_convert(rows, &pos, -1, blk, made);
+	if (made) series_made(made, blk);
+	return blk;
+}
+
+static size_t value_size(const REBYTE *p) {
+	u32 bytes;
+	switch (*p) {
+	case SQLITE_INTEGER:
+	case SQLITE_FLOAT:
+		return 9;
+	case SQLITE_TEXT:
+	case SQLITE_BLOB:
+		memcpy(&bytes, p + 1, 4);
+		return 5 + (size_t)bytes;
+	}
+	return 1;
+}
+
+// Returns the encoded value of the column (0-based) in the row at `pos`.
+const REBYTE* rows_column(SQLITE_ROWS *rows, size_t pos, int col) {
+	const REBYTE *p = rows->data + pos;
+	while (col-- > 0) p += value_size(p);
+	return p;
+}
+
+// Compares two encoded values using the SQLite sort order:
+// NULL < numbers < text < blob (text and blob are compared as bytes).
+int rows_compare(const REBYTE *a, const REBYTE *b) {
+	int ca = (*a == SQLITE_NULL) ? 0 : (*a == SQLITE_TEXT) ? 2 : (*a == SQLITE_BLOB) ? 3 : 1;
+	int cb = (*b == SQLITE_NULL) ? 0 : (*b == SQLITE_TEXT) ? 2 : (*b == SQLITE_BLOB) ? 3 : 1;
+	u32 la, lb;
+	i64 ia, ib;
+	double da, db;
+	int rc;
+
+	if (ca != cb) return ca - cb;
+	switch (ca) {
+	case 1:
+		if (*a == SQLITE_INTEGER && *b == SQLITE_INTEGER) {
+			memcpy(&ia, a + 1, 8);
+			memcpy(&ib, b + 1, 8);
+			return (ia > ib) - (ia < ib);
+		}
+		if (*a == SQLITE_INTEGER) { memcpy(&ia, a + 1, 8); da = (double)ia; }
+		else memcpy(&da, a + 1, 8);
+		if (*b == SQLITE_INTEGER) { memcpy(&ib, b + 1, 8); db = (double)ib; }
+		else memcpy(&db, b + 1, 8);
+		return (da > db) - (da < db);
+	case 2:
+	case 3:
+		memcpy(&la, a + 1, 4);
+		memcpy(&lb, b + 1, 4);
+		rc = memcmp(a + 5, b + 5, MIN(la, lb));
+		return rc ? rc : (la > lb) - (la < lb);
+	}
+	return 0;
+}
+
+void rows_clear(SQLITE_ROWS *rows) {
+	rows->used  = 0;
+	rows->count = 0;
+}
+
+void rows_free(SQLITE_ROWS *rows) {
+	free(rows->data);
+	CLEARS(rows);
+}
@@ -0,0 +1,74 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Read snapshots of WAL databases (requires SQLITE_ENABLE_SNAPSHOT).
+//
+// A snapshot identifies one state of the database. Any connection to the
+// same file may start a read transaction at it, as long as the WAL was not
+// checkpointed past it (or reset) since the snapshot was taken.
+
+#include "sqlite-rebol-extension.h"
+
+#ifdef SQLITE_ENABLE_SNAPSHOT
+
+// Takes the state seen by the current read transaction, or the latest one
+// when the connection is in the autocommit mode.
+int snapshot_take(sqlite3 *db, sqlite3_snapshot **snapshot) {
+	REBOOL began = FALSE;
+	int rc;
+
+	if (sqlite3_get_autocommit(db)) {
+		rc = sqlite3_exec(db, "BEGIN", NULL, NULL, NULL);
+		if (rc != SQLITE_OK) return rc;
+		began = TRUE;
+	}
+	rc = sqlite3_snapshot_get(db, "main", snapshot);
+	if (began) sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
+	return rc;
+}
+
+// Starts a read transaction at the snapshot.
+int snapshot_begin(sqlite3 *db, sqlite3_snapshot *snapshot) {
+	REBOOL began = FALSE;
+	int rc;
+
+	if (sqlite3_get_autocommit(db)) {
+		rc = sqlite3_exec(db, "BEGIN", NULL, NULL, NULL);
+		if (rc != SQLITE_OK) return rc;
+		began = TRUE;
+	}
+	rc = sqlite3_snapshot_open(db, "main", snapshot);
+	if (rc != SQLITE_OK && began) sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+	return rc;
+}
+
+int snapshot_compare(sqlite3_snapshot *a, sqlite3_snapshot *b) {
+	return sqlite3_snapshot_cmp(a, b);
+}
+
+void snapshot_free(sqlite3_snapshot *snapshot) {
+	sqlite3_snapshot_free(snapshot);
+}
+
+#else
+
+int snapshot_take(sqlite3 *db, sqlite3_snapshot **snapshot) {
+	*snapshot = NULL;
+	return SQLITE_ERROR;
+}
+int snapshot_begin(sqlite3 *db, sqlite3_snapshot *snapshot) {
+	return SQLITE_ERROR;
+}
+int snapshot_compare(sqlite3_snapshot *a, sqlite3_snapshot *b) {
+	return 0;
+}
+void snapshot_free(sqlite3_snapshot *snapshot) {}
+
+#endif
@@ -0,0 +1,174 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Minimal portable threads used by the background workers.
+//
+// SQLITE_LOCK is a mutex with one condition variable (a monitor), which is
+// all the workers need. Both types are opaque, so the platform headers are
+// included only here (also for the monotonic clock).
+
+#include "sqlite-rebol-extension.h"
+
+// set in threads started by thread_start, which must not call Rebol
+static THREAD_LOCAL REBOOL helper_thread = FALSE;
+
+REBOOL thread_is_helper(void) {
+	return helper_thread;
+}
+
+#ifdef TO_WINDOWS
+#include <windows.h>
+
+struct sqlite_thread {
+	HANDLE handle;
+	void (*func)(void *arg);
+	void  *arg;
+};
+struct sqlite_lock {
+	CRITICAL_SECTION   mutex;
+	CONDITION_VARIABLE cond;
+};
+
+static DWORD WINAPI thread_main(LPVOID data) {
+	SQLITE_THREAD *thread = (SQLITE_THREAD*)data;
+	helper_thread = TRUE;
+	thread->func(thread->arg);
+	return 0;
+}
+
+SQLITE_THREAD* thread_start(void (*func)(void *arg), void *arg) {
+	SQLITE_THREAD *thread = malloc(sizeof(SQLITE_THREAD));
+	if (!thread) return NULL;
+	thread->func = func;
+	thread->arg  = arg;
+	thread->handle = CreateThread(NULL, 0, thread_main, thread, 0, NULL);
+	if (!thread->handle) {
+		free(thread);
+		return NULL;
+	}
+	return thread;
+}
+
+void thread_join(SQLITE_THREAD *thread) {
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+	free(thread);
+}
+
+SQLITE_LOCK* lock_new(void) {
+	SQLITE_LOCK *lock = malloc(sizeof(SQLITE_LOCK));
+	if (!lock) return NULL;
+	InitializeCriticalSection(&lock->mutex);
+	InitializeConditionVariable(&lock->cond);
+	return lock;
+}
+void lock_free(SQLITE_LOCK *lock) {
+	DeleteCriticalSection(&lock->mutex);
+	free(lock);
+}
+void lock_enter(SQLITE_LOCK *lock)  { EnterCriticalSection(&lock->mutex); }
+void lock_leave(SQLITE_LOCK *lock)  { LeaveCriticalSection(&lock->mutex); }
+void lock_wait(SQLITE_LOCK *lock)   { SleepConditionVariableCS(&lock->cond, &lock->mutex, INFINITE); }
+void lock_notify(SQLITE_LOCK *lock) { WakeAllConditionVariable(&lock->cond); }
+void lock_wait_ms(SQLITE_LOCK *lock, int ms) { SleepConditionVariableCS(&lock->cond, &lock->mutex, (DWORD)ms); }
+
+i64 monotonic_ms(void) {
+	return (i64)GetTickCount64();
+}
+
+i64 monotonic_ns(void) {
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (i64)(counter.QuadPart / frequency.QuadPart) * 1000000000
+		+ (i64)(counter.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+}
+
+#else
+#include <pthread.h>
+#include <time.h>
+
+struct sqlite_thread {
+	pthread_t handle;
+	void (*func)(void *arg);
+	void  *arg;
+};
+struct sqlite_lock {
+	pthread_mutex_t mutex;
+	pthread_cond_t  cond;
+};
+
+static void* thread_main(void *data) {
+	SQLITE_THREAD *thread = (SQLITE_THREAD*)data;
+	helper_thread = TRUE;
+	thread->func(thread->arg);
+	return NULL;
+}
+
+SQLITE_THREAD* thread_start(void (*func)(void *arg), void *arg) {
+	SQLITE_THREAD *thread = malloc(sizeof(SQLITE_THREAD));
+	if (!thread) return NULL;
+	thread->func = func;
+	thread->arg  = arg;
+	if (0 != pthread_create(&thread->handle, NULL, thread_main, thread)) {
+		free(thread);
+		return NULL;
+	}
+	return thread;
+}
+
+void thread_join(SQLITE_THREAD *thread) {
+	pthread_join(thread->handle, NULL);
+	free(thread);
+}
+
+SQLITE_LOCK* lock_new(void) {
+	SQLITE_LOCK *lock = malloc(sizeof(SQLITE_LOCK));
+	if (!lock) return NULL;
+	pthread_mutex_init(&lock->mutex, NULL);
+	pthread_cond_init(&lock->cond, NULL);
+	return lock;
+}
+void lock_free(SQLITE_LOCK *lock) {
+	pthread_cond_destroy(&lock->cond);
+	pthread_mutex_destroy(&lock->mutex);
+	free(lock);
+}
+void lock_enter(SQLITE_LOCK *lock)  { pthread_mutex_lock(&lock->mutex); }
+void lock_leave(SQLITE_LOCK *lock)  { pthread_mutex_unlock(&lock->mutex); }
+void lock_wait(SQLITE_LOCK *lock)   { pthread_cond_wait(&lock->cond, &lock->mutex); }
+void lock_notify(SQLITE_LOCK *lock) { pthread_cond_broadcast(&lock->cond); }
+
+void lock_wait_ms(SQLITE_LOCK *lock, int ms) {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec  += ms / 1000;
+	ts.tv_nsec += (long)(ms % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	pthread_cond_timedwait(&lock->cond, &lock->mutex, &ts);
+}
+
+i64 monotonic_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (i64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+i64 monotonic_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (i64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#endif
@@ -0,0 +1,820 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Trace events recorded into a fixed-size ring buffer of the connection,
+// and the slow-query log.
+//
+// SQLite calls the trace callback while it holds the connection's mutex
+// (or the connection is used by a single thread), so the callback only
+// writes the next slot without any other locking or allocation. When the
+// buffer is full, the oldest event is overwritten. Events are taken by the
+// `trace-events` command, which copies the ring out under the same mutex.
+//
+// When a statement runs longer than the slow-query threshold, its expanded
+// SQL and counters of the run are kept in a small bounded log (see
+// `slow-log`). Counters of a run are differences from the values at its
+// first step (SQLITE_TRACE_STMT event). No statement may be run from the
+// callback, so EXPLAIN QUERY PLAN of the logged SQL is made when the log
+// is drained (it is the plan at that time).
+//
+// Query statistics are aggregated per fingerprint of the SQL (text with
+// literals and parameters replaced by `?`) in a fixed-size hash table, so
+// the callback does not allocate. Runs of fingerprints which do not fit are
+// aggregated together in one more slot (returned with `fingerprint: none`).
+//
+// The index advisor collects statements which built automatic indexes or
+// did many full-scan steps in a run; they are analyzed later on demand
+// (see sqlite-advisor.c). Query plans are checked for changes in
+// sqlite-plans.c and finished runs may be exported into a trace file
+// (see sqlite-export.c).
+
+#include "sqlite-rebol-extension.h"
+#include <string.h>
+
+#define TRACE_DEFAULT_SIZE 1024
+#define SLOW_LOG_SIZE      64
+#define RUNNING_MAX        16  // statements being evaluated at once on a connection
+#define STMT_COUNTERS      8
+#define STATS_SIZE         256 // fingerprints (power of 2)
+#define HISTOGRAM_SIZE     8   // <10us <100us <1ms <10ms <100ms <1s <10s >=10s
+#define ADVICE_SIZE        64  // statements collected by the index advisor
+
+// runs of statements are followed by any of these
+#define TRACKING(log) ((log)->slow_ns || (log)->stats || (log)->advising || (log)->plans || (log)->track)
+
+static const int counter_ops[STMT_COUNTERS] = {
+	SQLITE_STMTSTATUS_FULLSCAN_STEP, SQLITE_STMTSTATUS_SORT,
+	SQLITE_STMTSTATUS_AUTOINDEX,     SQLITE_STMTSTATUS_VM_STEP,
+	SQLITE_STMTSTATUS_REPREPARE,     SQLITE_STMTSTATUS_RUN,
+	SQLITE_STMTSTATUS_FILTER_HIT,    SQLITE_STMTSTATUS_FILTER_MISS
+};
+static const char *counter_names[STMT_COUNTERS] = {
+	"fullscan-steps", "sorts", "auto-indexes", "vm-steps",
+	"reprepares", "runs", "filter-hits", "filter-misses"
+};
+
+typedef struct slow_query {
+	i64    time;       // ns, monotonic clock
+	i64    duration;   // ns
+	char*  sql;        // expanded SQL (sqlite3_malloc)
+	char*  text;       // SQL of the statement to be explained (sqlite3_malloc)
+	int    counters[STMT_COUNTERS];
+} SLOW_QUERY;
+
+typedef struct running_stmt {
+	sqlite3_stmt* stmt;
+	int    counters[STMT_COUNTERS];
+	i64    rows;
+} RUNNING_STMT;
+
+typedef struct query_stats {
+	u32    hash;       // of the whole fingerprint
+	char   sql[TRACE_SQL_SIZE]; // fingerprint (truncated)
+	i64    calls;      // 0 = empty slot
+	i64    total;      // ns
+	i64    min;
+	i64    max;
+	i64    rows;
+	i64    fullscan_steps;
+	u32    histogram[HISTOGRAM_SIZE];
+} QUERY_STATS;
+
+typedef struct advice_candidate {
+	u32    hash;       // fingerprint
+	char*  sql;        // expanded SQL of the first run (sqlite3_malloc)
+	i64    runs;
+	i64    auto_indexes;
+	i64    fullscan_steps;
+} ADVICE_CANDIDATE;
+
+struct reb_sqlite_trace {
+	SQLITE_TRACE_EVENT* events;
+	u32    size;       // capacity (events)
+	u64    written;    // all recorded events
+	u64    taken;      // events before this one were drained or overwritten
+	unsigned mask;     // events recorded into the ring
+	REBOOL expanded;   // record SQL with bound parameters
+	// slow-query log
+	i64    slow_ns;    // threshold, 0 = no log
+	SLOW_QUERY slow[SLOW_LOG_SIZE];
+	u64    slow_written;
+	u64    slow_taken;
+	RUNNING_STMT running[RUNNING_MAX];
+	int    running_count;
+	// statistics per fingerprint
+	QUERY_STATS* stats; // STATS_SIZE slots + one for all not fitting
+	u32    stats_count;
+	// index advisor
+	REBOOL advising;
+	i64    advice_threshold; // full-scan steps of a run
+	ADVICE_CANDIDATE advice[ADVICE_SIZE];
+	u32    advice_count;
+	// query plans
+	SQLITE_PLANS* plans;
+	// track of the connection in the exported trace file (0 = no export)
+	int    track;
+};
+
+// Set while the extension runs its own statements (EXPLAIN QUERY PLAN and
+// the index analysis), so their events are ignored. It is per thread, so
+// statements of other threads are recorded in the meantime.
+static THREAD_LOCAL REBOOL explaining = FALSE;
+
+// Used around statements run by the extension in other modules.
+void trace_ignore(REBOOL on) {
+	explaining = on;
+}
+
+// FNV-1a hash of the SQL text, so the same statement has always the same hash.
+u32 sql_hash(const char *sql) {
+	u32 hash = 2166136261u;
+	if (!sql) return 0;
+	while (*sql) {
+		hash ^= (REBYTE)*sql++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void copy_sql(SQLITE_TRACE_EVENT *event, const char *sql) {
+	size_t len = sql ? strlen(sql) : 0;
+	if (len >= TRACE_SQL_SIZE) {
+		len = TRACE_SQL_SIZE - 1;
+		// do not split an UTF-8 sequence
+		while (len > 0 && ((REBYTE)sql[len] & 0xC0) == 0x80) len--;
+	}
+	if (len) memcpy(event->sql, sql, len);
+	event->sql[len] = 0;
+}
+
+#define IS_IDENT(c) (IS_ALNUM(c) || (c) == '_' || (c) == '$' || (REBYTE)(c) >= 0x80)
+#define IS_ALNUM(c) (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') || ((c) >= '0' && (c) <= '9'))
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+#define PUNCTUATION "(),;=<>!+-/%|&~."
+
+// Writes the normalized SQL (truncated to `size`) with literals and parameters
+// replaced by `?`, comments removed, white space collapsed and unquoted text
+// in lower case. Returns hash of the whole normalized text.
+u32 sql_fingerprint(const char *sql, char *out, size_t size) {
+	u32 hash = 2166136261u;
+	size_t len = 0;
+	REBOOL space = FALSE;
+	char c, quote, prev = 0;
+
+#define EMIT(ch) do {                                         \
+		char e = (ch);                                        \
+		hash ^= (REBYTE)e; hash *= 16777619u;                 \
+		if (len + 1 < size) out[len++] = e;                   \
+		prev = e;                                             \
+	} while (0)
+// white space is kept only between words (not around operators and punctuation)
+#define EMIT_SPACE() if (space && len && !strchr(PUNCTUATION, prev) && !strchr(PUNCTUATION, c)) { EMIT(' '); } space = FALSE
+
+	if (!sql) sql = "";
+	while ((c = *sql)) {
+		if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f') {
+			space = TRUE; sql++;
+		}
+		else if (c == '-' && sql[1] == '-') {
+			while (*sql && *sql != '\n') sql++;
+			space = TRUE;
+		}
+		else if (c == '/' && sql[1] == '*') {
+			for (sql += 2; *sql && !(sql[0] == '*' && sql[1] == '/'); sql++);
+			if (*sql) sql += 2;
+			space = TRUE;
+		}
+		else if (c == '\'' || ((c == 'x' || c == 'X') && sql[1] == '\'' && (space || !IS_IDENT(prev)))) {
+			// string or blob literal ('' is an escaped quote)
+			if (c != '\'') sql++;
+			for (sql++; *sql; sql++) {
+				if (*sql == '\'') {
+					if (sql[1] != '\'') { sql++; break; }
+					sql++;
+				}
+			}
+			EMIT_SPACE(); EMIT('?');
+		}
+		else if ((IS_DIGIT(c) || (c == '.' && IS_DIGIT(sql[1]))) && (space || !IS_IDENT(prev))) {
+			// number (also hexadecimal and with an exponent)
+			while (IS_ALNUM(*sql) || *sql == '.' || *sql == '_'
+				|| ((*sql == '+' || *sql == '-') && (sql[-1] == 'e' || sql[-1] == 'E') && !(sql[-2] == 'x' || sql[-2] == 'X'))) sql++;
+			EMIT_SPACE(); EMIT('?');
+		}
+		else if (c == '?' || ((c == ':' || c == '@' || c == '$') && IS_IDENT(sql[1]))) {
+			// parameter
+			for (sql++; IS_IDENT(*sql); sql++);
+			EMIT_SPACE(); EMIT('?');
+		}
+		else if (c == '"' || c == '`' || c == '[') {
+			// quoted identifier, kept as it is
+			quote = (c == '[') ? ']' : c;
+			EMIT_SPACE(); EMIT(c);
+			for (sql++; *sql; sql++) {
+				EMIT(*sql);
+				if (*sql == quote) {
+					if (sql[1] != quote || quote == ']') { sql++; break; }
+					EMIT(*++sql);
+				}
+			}
+		}
+		else {
+			EMIT_SPACE();
+			EMIT((c >= 'A' && c <= 'Z') ? c + 32 : c);
+			sql++;
+		}
+	}
+	if (size) out[len] = 0;
+	return hash;
+#undef EMIT
+#undef EMIT_SPACE
+}
+
+static void record_event(SQLITE_TRACE_LOG *log, unsigned type, sqlite3_stmt *stmt, void *x) {
+	SQLITE_TRACE_EVENT *event = &log->events[log->written % log->size];
+	char *sql;
+
+	event->type     = type;
+	event->time     = monotonic_ns();
+	event->duration = (type == SQLITE_TRACE_PROFILE) ? *(i64*)x : 0;
+	if (type == SQLITE_TRACE_CLOSE) { // stmt is the connection
+		event->hash = 0;
+		event->sql[0] = 0;
+	}
+	else {
+		event->hash = sql_hash(sqlite3_sql(stmt));
+		if (log->expanded && (sql = sqlite3_expanded_sql(stmt))) {
+			copy_sql(event, sql);
+			sqlite3_free(sql);
+		}
+		else copy_sql(event, sqlite3_sql(stmt));
+	}
+	log->written++;
+	if (log->written - log->taken > log->size) log->taken = log->written - log->size;
+}
+
+static void slow_free(SLOW_QUERY *slow) {
+	sqlite3_free(slow->sql);
+	sqlite3_free(slow->text);
+	slow->sql = slow->text = NULL;
+}
+
+// Remembers counters of the statement at the start of its run.
+static void run_started(SQLITE_TRACE_LOG *log, sqlite3_stmt *stmt) {
+	RUNNING_STMT *run;
+	int i;
+
+	// triggers report their statements using the same handle
+	for (i = 0; i < log->running_count; i++) {
+		if (log->running[i].stmt == stmt) return;
+	}
+	if (log->running_count == RUNNING_MAX) {
+		// should not happen, the oldest one will use its total counters
+		memmove(&log->running[0], &log->running[1], (RUNNING_MAX - 1) * sizeof(RUNNING_STMT));
+		log->running_count--;
+	}
+	run = &log->running[log->running_count++];
+	run->stmt = stmt;
+	run->rows = 0;
+	for (i = 0; i < STMT_COUNTERS; i++)
+		run->counters[i] = sqlite3_stmt_status(stmt, counter_ops[i], 0);
+}
+
+static void run_row(SQLITE_TRACE_LOG *log, sqlite3_stmt *stmt) {
+	int n;
+	for (n = 0; n < log->running_count; n++) {
+		if (log->running[n].stmt == stmt) { log->running[n].rows++; return; }
+	}
+}
+
+// Takes counters and returned rows of the finished run.
+static i64 run_finished(SQLITE_TRACE_LOG *log, sqlite3_stmt *stmt, int *counters) {
+	int i, n, found = -1;
+	i64 rows = 0;
+
+	for (n = 0; n < log->running_count; n++) {
+		if (log->running[n].stmt == stmt) { found = n; break; }
+	}
+	for (i = 0; i < STMT_COUNTERS; i++) {
+		counters[i] = sqlite3_stmt_status(stmt, counter_ops[i], 0);
+		// counters may be reset in the meantime
+		if (found >= 0 && counters[i] >= log->running[found].counters[i])
+			counters[i] -= log->running[found].counters[i];
+	}
+	if (found >= 0) {
+		rows = log->running[found].rows;
+		log->running[found] = log->running[--log->running_count];
+	}
+	return rows;
+}
+
+static void explain(sqlite3 *db, const char *sql, SQLITE_ROWS *plan) {
+	sqlite3_stmt *stmt = NULL;
+	char *query;
+
+	if (!sql || !(query = sqlite3_mprintf("EXPLAIN QUERY PLAN %s", sql))) return;
+	explaining = TRUE;
+	// fails for statements which cannot be explained (like EXPLAIN itself)
+	if (SQLITE_OK == sqlite3_prepare_v2(db, query, -1, &stmt, NULL)) {
+		while (SQLITE_ROW == sqlite3_step(stmt)) {
+			if (SQLITE_OK != rows_append(plan, stmt)) break;
+		}
+	}
+	sqlite3_finalize(stmt);
+	sqlite3_free(query);
+	explaining = FALSE;
+}
+
+static void record_slow(SQLITE_TRACE_LOG *log, sqlite3_stmt *stmt, i64 duration, int *counters) {
+	SLOW_QUERY *slow = &log->slow[log->slow_written % SLOW_LOG_SIZE];
+	slow_free(slow);
+	slow->time = monotonic_ns();
+	slow->duration = duration;
+	slow->sql = sqlite3_expanded_sql(stmt);
+	slow->text = sqlite3_mprintf("%s", sqlite3_sql(stmt));
+	memcpy(slow->counters, counters, sizeof(slow->counters));
+	log->slow_written++;
+	if (log->slow_written - log->slow_taken > SLOW_LOG_SIZE)
+		log->slow_taken = log->slow_written - SLOW_LOG_SIZE;
+}
+
+static void record_stats(SQLITE_TRACE_LOG *log, sqlite3_stmt *stmt, i64 duration, i64 rows, int *counters) {
+	QUERY_STATS *stats;
+	char sql[TRACE_SQL_SIZE];
+	u32 hash = sql_fingerprint(sqlite3_sql(stmt), sql, TRACE_SQL_SIZE);
+	u32 i = hash & (STATS_SIZE - 1);
+	i64 limit;
+	int bucket;
+
+	// open addressing with linear probing
+	while (log->stats[i].calls && log->stats[i].hash != hash) i = (i + 1) & (STATS_SIZE - 1);
+	stats = &log->stats[i];
+	if (!stats->calls) {
+		// keep some free slots, so the probing stays short
+		if (log->stats_count >= STATS_SIZE * 3 / 4) {
+			stats = &log->stats[STATS_SIZE];
+		}
+		else {
+			log->stats_count++;
+			stats->hash = hash;
+			memcpy(stats->sql, sql, TRACE_SQL_SIZE);
+		}
+		if (!stats->calls) stats->min = duration;
+	}
+	stats->calls++;
+	stats->total += duration;
+	if (duration < stats->min) stats->min = duration;
+	if (duration > stats->max) stats->max = duration;
+	stats->rows += rows;
+	stats->fullscan_steps += counters[0];
+	for (bucket = 0, limit = 10000; bucket < HISTOGRAM_SIZE - 1 && duration >= limit; bucket++) limit *= 10;
+	stats->histogram[bucket]++;
+}
+
+static void record_candidate(SQLITE_TRACE_LOG *log, sqlite3_stmt *stmt, int *counters) {
+	ADVICE_CANDIDATE *candidate = NULL;
+	char sql[TRACE_SQL_SIZE];
+	u32 hash, i;
+
+	if (!counters[2] && (!log->advice_threshold || counters[0] < log->advice_threshold)) return;
+	hash = sql_fingerprint(sqlite3_sql(stmt), sql, TRACE_SQL_SIZE);
+	for (i = 0; i < log->advice_count; i++) {
+		if (log->advice[i].hash == hash) { candidate = &log->advice[i]; break; }
+	}
+	if (!candidate) {
+		if (log->advice_count == ADVICE_SIZE) return;
+		candidate = &log->advice[log->advice_count++];
+		candidate->hash = hash;
+		candidate->sql = sqlite3_expanded_sql(stmt);
+	}
+	candidate->runs++;
+	candidate->auto_indexes += counters[2];
+	candidate->fullscan_steps += counters[0];
+}
+
+static int trace_callback(unsigned type, void *data, void *p, void *x) {
+	SQLITE_CONTEXT *ctx = (SQLITE_CONTEXT*)data;
+	SQLITE_TRACE_LOG *log = ctx->trace;
+	sqlite3_stmt *stmt = (sqlite3_stmt*)p;
+	int counters[STMT_COUNTERS];
+	i64 rows, duration;
+
+	if (!log || explaining) return SQLITE_OK;
+	if ((log->mask & type) && log->size) record_event(log, type, stmt, x);
+	if (!TRACKING(log)) return SQLITE_OK;
+	switch (type) {
+	case SQLITE_TRACE_STMT:
+		run_started(log, stmt);
+		break;
+	case SQLITE_TRACE_ROW:
+		run_row(log, stmt);
+		break;
+	case SQLITE_TRACE_PROFILE:
+		duration = *(i64*)x;
+		rows = run_finished(log, stmt, counters);
+		if (log->stats) record_stats(log, stmt, duration, rows, counters);
+		if (log->slow_ns && duration >= log->slow_ns) record_slow(log, stmt, duration, counters);
+		if (log->advising) record_candidate(log, stmt, counters);
+		if (log->plans) plans_finished(log->plans, stmt);
+		if (log->track) export_statement(log->track, stmt, duration, rows, counters);
+		break;
+	}
+	return SQLITE_OK;
+}
+
+static SQLITE_TRACE_LOG* trace_log(SQLITE_CONTEXT *ctx) {
+	if (!ctx->trace) ctx->trace = calloc(1, sizeof(SQLITE_TRACE_LOG));
+	return ctx->trace;
+}
+
+// Installs the callback for events used by the ring, the slow-query log
+// or the query statistics.
+static int trace_update(SQLITE_CONTEXT *ctx) {
+	SQLITE_TRACE_LOG *log = ctx->trace;
+	unsigned mask = log->mask;
+	if (TRACKING(log)) mask |= SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE;
+	if (log->stats || log->track) mask |= SQLITE_TRACE_ROW;
+	return sqlite3_trace_v2(ctx->db, mask, mask ? trace_callback : NULL, ctx);
+}
+
+// Sets the traced events (mask 0 stops tracing, the buffer is kept until
+// drained). Size 0 keeps the current capacity, else recorded events are dropped.
+int trace_start(SQLITE_CONTEXT *ctx, unsigned mask, u32 size, REBOOL expanded) {
+	sqlite3_mutex *mutex = sqlite3_db_mutex(ctx->db);
+	SQLITE_TRACE_LOG *log;
+	SQLITE_TRACE_EVENT *events = NULL;
+
+	if (!mask && !ctx->trace) return SQLITE_OK;
+	if (!(log = trace_log(ctx))) return SQLITE_NOMEM;
+	if (!size && mask && !log->size) size = TRACE_DEFAULT_SIZE;
+	if (size && !(events = malloc(size * sizeof(SQLITE_TRACE_EVENT)))) return SQLITE_NOMEM;
+
+	sqlite3_mutex_enter(mutex);
+	if (events) {
+		free(log->events);
+		log->events  = events;
+		log->size    = size;
+		log->written = log->taken = 0;
+	}
+	log->mask = mask;
+	log->expanded = expanded;
+	sqlite3_mutex_leave(mutex);
+	return trace_update(ctx);
+}
+
+// Appends recorded events as: type time duration hash sql, and removes them.
+// Returns number of events (main thread only).
+int trace_drain(SQLITE_CONTEXT *ctx, REBSER *blk) {
+	sqlite3_mutex *mutex;
+	SQLITE_TRACE_LOG *log = ctx->trace;
+	SQLITE_TRACE_EVENT *events, *event;
+	RXIARG arg;
+	u32 count, i;
+	const char *name;
+
+	if (!log || !log->size || !ctx->db) return 0;
+	mutex = sqlite3_db_mutex(ctx->db);
+	sqlite3_mutex_enter(mutex);
+	count = (u32)(log->written - log->taken);
+	events = count ? malloc(count * sizeof(SQLITE_TRACE_EVENT)) : NULL;
+	if (events) {
+		for (i = 0; i < count; i++)
+			events[i] = log->events[(log->taken + i) % log->size];
+		log->taken = log->written;
+	}
+	else count = 0;
+	sqlite3_mutex_leave(mutex);
+
+	// Rebol values are made after the mutex is released
+	for (i = 0; i < count; i++) {
+		event = &events[i];
+		switch (event->type) {
+			case SQLITE_TRACE_STMT:    name = "stmt";    break;
+			case SQLITE_TRACE_PROFILE: name = "profile"; break;
+			case SQLITE_TRACE_ROW:     name = "row";     break;
+			default:                   name = "close";
+		}
+		arg.int32a = RL_MAP_WORD((REBYTE*)name);
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_WORD);
+		arg.int64 = event->time;
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_INTEGER);
+		arg.int64 = event->duration;
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, event->type == SQLITE_TRACE_PROFILE ? RXT_TIME : RXT_NONE);
+		arg.int64 = event->hash;
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_INTEGER);
+		arg.series = RL_DECODE_UTF_STRING((REBYTE*)event->sql, (REBCNT)strlen(event->sql), 8, 0, 0);
+		arg.index  = 0;
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_STRING);
+	}
+	free(events);
+	return count;
+}
+
+// Sets the slow-query threshold (0 = no log, logged queries are kept).
+int slow_log_start(SQLITE_CONTEXT *ctx, i64 ms) {
+	sqlite3_mutex *mutex = sqlite3_db_mutex(ctx->db);
+	SQLITE_TRACE_LOG *log;
+
+	if (!ms && !ctx->trace) return SQLITE_OK;
+	if (!(log = trace_log(ctx))) return SQLITE_NOMEM;
+	sqlite3_mutex_enter(mutex);
+	if (!TRACKING(log)) log->running_count = 0;
+	log->slow_ns = ms * 1000000;
+	sqlite3_mutex_leave(mutex);
+	return trace_update(ctx);
+}
+
+// Appends logged slow queries as blocks and removes them. Their plans are
+// explained here, after the mutex is released (main thread only).
+int slow_log_drain(SQLITE_CONTEXT *ctx, REBSER *blk) {
+	sqlite3_mutex *mutex;
+	SQLITE_TRACE_LOG *log = ctx->trace;
+	SLOW_QUERY *slow, *slows;
+	SQLITE_ROWS plan;
+	REBSER *entry;
+	RXIARG arg;
+	int count, i, n;
+
+	if (!log || !ctx->db) return 0;
+	mutex = sqlite3_db_mutex(ctx->db);
+	sqlite3_mutex_enter(mutex);
+	count = (int)(log->slow_written - log->slow_taken);
+	slows = count ? malloc(count * sizeof(SLOW_QUERY)) : NULL;
+	if (slows) {
+		// the entries are moved out, so no Rebol value is made under the mutex
+		for (i = 0; i < count; i++) {
+			slow = &log->slow[(log->slow_taken + i) % SLOW_LOG_SIZE];
+			slows[i] = *slow;
+			CLEARS(slow);
+		}
+		log->slow_taken = log->slow_written;
+	}
+	else count = 0;
+	sqlite3_mutex_leave(mutex);
+
+	for (i = 0; i < count; i++) {
+		slow = &slows[i];
+		entry = RL_MAKE_BLOCK(32);
+		arg.int32a = AS_WORD("sql");
+		RL_SET_VALUE(entry, SERIES_TAIL(entry), arg, RXT_SET_WORD);
+		arg.series = RL_DECODE_UTF_STRING((REBYTE*)(slow->sql ? slow->sql : ""), slow->sql ? (REBCNT)strlen(slow->sql) : 0, 8, 0, 0);
+		arg.index  = 0;
+		RL_SET_VALUE(entry, SERIES_TAIL(entry), arg, RXT_STRING);
+		append_field(entry, "time", slow->time, RXT_INTEGER);
+		append_field(entry, "duration", slow->duration, RXT_TIME);
+		for (n = 0; n < STMT_COUNTERS; n++)
+			append_field(entry, counter_names[n], slow->counters[n], RXT_INTEGER);
+		arg.int32a = AS_WORD("plan");
+		RL_SET_VALUE(entry, SERIES_TAIL(entry), arg, RXT_SET_WORD);
+		CLEARS(&plan);
+		explain(ctx->db, slow->text, &plan);
+		arg.series = rows_to_block(&plan, NULL);
+		arg.index  = 0;
+		RL_SET_VALUE(entry, SERIES_TAIL(entry), arg, RXT_BLOCK);
+		rows_free(&plan);
+
+		arg.series = entry;
+		arg.index  = 0;
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_BLOCK);
+		slow_free(slow);
+	}
+	free(slows);
+	return count;
+}
+
+// Starts (or stops and drops) aggregation of query statistics.
+int query_stats_start(SQLITE_CONTEXT *ctx, REBOOL on) {
+	sqlite3_mutex *mutex = sqlite3_db_mutex(ctx->db);
+	SQLITE_TRACE_LOG *log;
+	QUERY_STATS *stats = NULL;
+
+	if (!on && !ctx->trace) return SQLITE_OK;
+	if (!(log = trace_log(ctx))) return SQLITE_NOMEM;
+	if (on && !log->stats && !(stats = calloc(STATS_SIZE + 1, sizeof(QUERY_STATS)))) return SQLITE_NOMEM;
+
+	sqlite3_mutex_enter(mutex);
+	if (on && !log->stats) {
+		if (!TRACKING(log)) log->running_count = 0;
+		log->stats = stats;
+		log->stats_count = 0;
+		stats = NULL;
+	}
+	else if (!on) {
+		stats = log->stats;
+		log->stats = NULL;
+	}
+	sqlite3_mutex_leave(mutex);
+	free(stats); // the dropped table, or one not needed
+	return trace_update(ctx);
+}
+
+// Appends a block for each fingerprint (and optionally clears the counters).
+// Returns number of fingerprints (main thread only).
+int query_stats_read(SQLITE_CONTEXT *ctx, REBSER *blk, REBOOL reset) {
+	sqlite3_mutex *mutex;
+	SQLITE_TRACE_LOG *log = ctx->trace;
+	QUERY_STATS *copy, *stats;
+	REBSER *entry, *histogram;
+	RXIARG arg;
+	u32 count = 0, i, n;
+
+	if (!log || !log->stats || !ctx->db) return 0;
+	if (!(copy = malloc((STATS_SIZE + 1) * sizeof(QUERY_STATS)))) return 0;
+	mutex = sqlite3_db_mutex(ctx->db);
+	sqlite3_mutex_enter(mutex);
+	for (i = 0; i <= STATS_SIZE; i++) {
+		if (log->stats[i].calls) copy[count++] = log->stats[i];
+	}
+	if (reset) {
+		memset(log->stats, 0, (STATS_SIZE + 1) * sizeof(QUERY_STATS));
+		log->stats_count = 0;
+	}
+	sqlite3_mutex_leave(mutex);
+
+	for (i = 0; i < count; i++) {
+		stats = &copy[i];
+		entry = RL_MAKE_BLOCK(24);
+		append_text (entry, "fingerprint", stats->sql[0] ? stats->sql : NULL);
+		append_field(entry, "hash",  stats->hash,  RXT_INTEGER);
+		append_field(entry, "calls", stats->calls, RXT_INTEGER);
+		append_field(entry, "total", stats->total, RXT_TIME);
+		append_field(entry, "min",   stats->min,   RXT_TIME);
+		append_field(entry, "max",   stats->max,   RXT_TIME);
+		append_field(entry, "rows",  stats->rows,  RXT_INTEGER);
+		append_field(entry, "fullscan-steps", stats->fullscan_steps, RXT_INTEGER);
+		histogram = RL_MAKE_BLOCK(HISTOGRAM_SIZE);
+		for (n = 0; n < HISTOGRAM_SIZE; n++) {
+			arg.int64 = stats->histogram[n];
+			RL_SET_VALUE(histogram, SERIES_TAIL(histogram), arg, RXT_INTEGER);
+		}
+		arg.int32a = AS_WORD("histogram");
+		RL_SET_VALUE(entry, SERIES_TAIL(entry), arg, RXT_SET_WORD);
+		arg.series = histogram;
+		arg.index  = 0;
+		RL_SET_VALUE(entry, SERIES_TAIL(entry), arg, RXT_BLOCK);
+
+		arg.series = entry;
+		arg.index  = 0;
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_BLOCK);
+	}
+	free(copy);
+	return count;
+}
+
+// Starts collecting statements for the index advisor: those which built
+// an automatic index, or did at least `threshold` full-scan steps in a run
+// (0 = only automatic indexes). Stopping drops collected statements.
+int advisor_start(SQLITE_CONTEXT *ctx, REBOOL on, i64 threshold) {
+	sqlite3_mutex *mutex = sqlite3_db_mutex(ctx->db);
+	SQLITE_TRACE_LOG *log;
+	u32 i;
+
+	if (!on && !ctx->trace) return SQLITE_OK;
+	if (!(log = trace_log(ctx))) return SQLITE_NOMEM;
+	sqlite3_mutex_enter(mutex);
+	if (on && !TRACKING(log)) log->running_count = 0;
+	log->advising = on;
+	log->advice_threshold = threshold;
+	if (!on) {
+		for (i = 0; i < log->advice_count; i++) sqlite3_free(log->advice[i].sql);
+		log->advice_count = 0;
+	}
+	sqlite3_mutex_leave(mutex);
+	return trace_update(ctx);
+}
+
+// Analyzes collected statements and appends a block with suggested indexes
+// for each of them. Analyzed statements are removed (main thread only).
+int advisor_drain(SQLITE_CONTEXT *ctx, REBSER *blk) {
+	sqlite3_mutex *mutex;
+	SQLITE_TRACE_LOG *log = ctx->trace;
+	ADVICE_CANDIDATE *candidates, *candidate;
+	sqlite3 *adb = NULL;
+	const char *file;
+	REBSER *entry;
+	RXIARG arg;
+	u32 count, i;
+
+	if (!log || !ctx->db) return 0;
+	mutex = sqlite3_db_mutex(ctx->db);
+	sqlite3_mutex_enter(mutex);
+	count = log->advice_count;
+	candidates = count ? malloc(count * sizeof(ADVICE_CANDIDATE)) : NULL;
+	if (candidates) {
+		memcpy(candidates, log->advice, count * sizeof(ADVICE_CANDIDATE));
+		log->advice_count = 0;
+	}
+	else count = 0;
+	sqlite3_mutex_leave(mutex);
+
+	// Indexes are measured on a private connection, so nothing is mixed with
+	// a transaction of this one (or of its async worker).
+	file = sqlite3_db_filename(ctx->db, "main");
+	if (count && file && *file) {
+		if (SQLITE_OK == sqlite3_open_v2(file, &adb, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, ctx->vfs))
+			sqlite3_busy_timeout(adb, 1000);
+		else {
+			sqlite3_close(adb);
+			adb = NULL;
+		}
+	}
+	// statements planned on this connection are not traced
+	explaining = TRUE;
+	for (i = 0; i < count; i++) {
+		candidate = &candidates[i];
+		entry = RL_MAKE_BLOCK(16);
+		append_text (entry, "sql",            candidate->sql);
+		append_field(entry, "runs",           candidate->runs,           RXT_INTEGER);
+		append_field(entry, "auto-indexes",   candidate->auto_indexes,   RXT_INTEGER);
+		append_field(entry, "fullscan-steps", candidate->fullscan_steps, RXT_INTEGER);
+		arg.int32a = AS_WORD("indexes");
+		RL_SET_VALUE(entry, SERIES_TAIL(entry), arg, RXT_SET_WORD);
+		arg.series = advise_indexes(ctx->db, adb, candidate->sql);
+		arg.index  = 0;
+		RL_SET_VALUE(entry, SERIES_TAIL(entry), arg, RXT_BLOCK);
+
+		arg.series = entry;
+		arg.index  = 0;
+		RL_SET_VALUE(blk, SERIES_TAIL(blk), arg, RXT_BLOCK);
+		sqlite3_free(candidate->sql);
+	}
+	explaining = FALSE;
+	sqlite3_close(adb);
+	free(candidates);
+	return count;
+}
+
+// Starts (or stops and drops) watching of query plans.
+int plans_watch(SQLITE_CONTEXT *ctx, REBOOL on) {
+	sqlite3_mutex *mutex = sqlite3_db_mutex(ctx->db);
+	SQLITE_TRACE_LOG *log;
+	SQLITE_PLANS *plans = NULL;
+
+	if (!on && !ctx->trace) return SQLITE_OK;
+	if (!(log = trace_log(ctx))) return SQLITE_NOMEM;
+	if (on && !log->plans && !(plans = plans_new())) return SQLITE_NOMEM;
+
+	sqlite3_mutex_enter(mutex);
+	if (on && !log->plans) {
+		if (!TRACKING(log)) log->running_count = 0;
+		log->plans = plans;
+		plans = NULL;
+	}
+	else if (!on) {
+		plans = log->plans;
+		log->plans = NULL;
+	}
+	sqlite3_mutex_leave(mutex);
+	plans_free(plans);
+	return trace_update(ctx);
+}
+
+SQLITE_PLANS* plans_watched(SQLITE_CONTEXT *ctx) {
+	return ctx->trace ? ctx->trace->plans : NULL;
+}
+
+// Starts export of the connection's statements into the file shared by all
+// exporting connections (NULL stops it). Returns SQLITE_MISUSE when another
+// file is being written.
+int trace_export(SQLITE_CONTEXT *ctx, const char *path) {
+	sqlite3_mutex *mutex = sqlite3_db_mutex(ctx->db);
+	SQLITE_TRACE_LOG *log;
+	const char *name;
+	int track = 0, rc;
+
+	if (!path && (!ctx->trace || !ctx->trace->track)) return SQLITE_OK;
+	if (!(log = trace_log(ctx))) return SQLITE_NOMEM;
+	if (path) {
+		if (log->track && export_writing(path)) return SQLITE_OK;
+		name = sqlite3_db_filename(ctx->db, "main");
+		rc = export_open(path, (name && *name) ? name : ":memory:", &track);
+		if (rc != SQLITE_OK) return rc;
+	}
+	sqlite3_mutex_enter(mutex);
+	if (!TRACKING(log)) log->running_count = 0;
+	if (log->track) export_close();
+	log->track = track;
+	sqlite3_mutex_leave(mutex);
+	return trace_update(ctx);
+}
+
+// Must be called after the connection is closed (it records the close event).
+void trace_release(SQLITE_CONTEXT *ctx) {
+	int i;
+	if (!ctx->trace) return;
+	if (ctx->trace->track) export_close();
+	for (i = 0; i < SLOW_LOG_SIZE; i++) slow_free(&ctx->trace->slow[i]);
+	free(ctx->trace->stats);
+	plans_free(ctx->trace->plans);
+	for (i = 0; i < (int)ctx->trace->advice_count; i++) sqlite3_free(ctx->trace->advice[i].sql);
+	free(ctx->trace->events);
+	free(ctx->trace);
+	ctx->trace = NULL;
+}
@@ -0,0 +1,98 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Waiting for shared-cache table locks using sqlite3_unlock_notify.
+//
+// When a statement of a shared-cache connection fails with
+// SQLITE_LOCKED_SHAREDCACHE, the thread waits until the blocking connection
+// finishes its transaction and then the statement is restarted. The wait is
+// limited by the busy timeout of the connection (see `busy`), so a connection
+// blocked by another one used on the same thread fails instead of waiting
+// forever. Deadlocks between waiting connections are detected by SQLite.
+
+#include "sqlite-rebol-extension.h"
+
+#ifdef SQLITE_ENABLE_UNLOCK_NOTIFY
+
+typedef struct unlock_wait {
+	SQLITE_LOCK *lock;
+	REBOOL       fired;
+} UNLOCK_WAIT;
+
+// May be called by any thread when the blocking transaction is finished.
+static void unlock_notify(void **args, int count) {
+	UNLOCK_WAIT *wait;
+	int i;
+	for (i = 0; i < count; i++) {
+		wait = (UNLOCK_WAIT*)args[i];
+		lock_enter(wait->lock);
+		wait->fired = TRUE;
+		lock_notify(wait->lock);
+		lock_leave(wait->lock);
+	}
+}
+
+static void update_stats(sqlite3 *db, SQLITE_CONTEXT *ctx, i64 waited, REBOOL failed) {
+	sqlite3_mutex *mutex = sqlite3_db_mutex(db);
+	sqlite3_mutex_enter(mutex);
+	ctx->busy.waits++;
+	ctx->busy.wait_time += waited;
+	if (waited > ctx->busy.max_wait) ctx->busy.max_wait = waited;
+	if (failed) ctx->busy.failures++;
+	sqlite3_mutex_leave(mutex);
+}
+
+// Returns SQLITE_OK when the statement may be restarted.
+static int unlock_wait(sqlite3 *db) {
+	SQLITE_CONTEXT *ctx;
+	UNLOCK_WAIT wait;
+	i64 start, left;
+	int rc;
+
+	if (sqlite3_extended_errcode(db) != SQLITE_LOCKED_SHAREDCACHE) return SQLITE_LOCKED;
+	ctx = sqlite3_get_clientdata(db, SQLITE_CTX_KEY);
+	if (!ctx || ctx->busy.timeout <= 0) return SQLITE_LOCKED;
+	if (!(wait.lock = lock_new())) return SQLITE_NOMEM;
+	wait.fired = FALSE;
+
+	start = monotonic_ms();
+	// fails with SQLITE_LOCKED when the wait would be a deadlock
+	rc = sqlite3_unlock_notify(db, unlock_notify, &wait);
+	if (rc == SQLITE_OK) {
+		lock_enter(wait.lock);
+		while (!wait.fired && (left = start + ctx->busy.timeout - monotonic_ms()) > 0)
+			lock_wait_ms(wait.lock, (int)left);
+		if (!wait.fired) rc = SQLITE_LOCKED;
+		lock_leave(wait.lock);
+		// cancels the callback, so the wait may be released
+		if (rc != SQLITE_OK) sqlite3_unlock_notify(db, NULL, NULL);
+	}
+	update_stats(db, ctx, monotonic_ms() - start, rc != SQLITE_OK);
+	lock_free(wait.lock);
+	return rc;
+}
+
+// sqlite3_step waiting for shared-cache table locks.
+int blocking_step(sqlite3_stmt *stmt) {
+	int rc;
+	while ((rc = sqlite3_step(stmt)) == SQLITE_LOCKED) {
+		if (SQLITE_OK != unlock_wait(sqlite3_db_handle(stmt))) break;
+		sqlite3_reset(stmt);
+	}
+	return rc;
+}
+
+#else
+
+int blocking_step(sqlite3_stmt *stmt) {
+	return sqlite3_step(stmt);
+}
+
+#endif
@@ -0,0 +1,757 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Page-compressed VFS (used by `open/compressed`)
+//
+// Only the main database file is compressed, journals and temp files are
+// passed to the default VFS untouched. The file layout is:
+//
+//   [header A][header B][page records and the page index in any order...]
+//
+// Headers are written alternately (by generation), so a torn header write
+// never destroys the last valid one. Each page is stored as an LZ4 block
+// (or raw, when it does not compress) at an offset kept in the page index.
+// Records are never overwritten while they are referenced by the last
+// written header; superseded space is reused only after the next header
+// is written (and synced).
+//
+// WAL mode is not supported: the file has no shared-memory methods, so
+// SQLite refuses `journal_mode=WAL` and uses a rollback journal instead.
+
+#include "sqlite-rebol-extension.h"
+#include <string.h>
+
+#define LZVFS_NAME         "rebol-lz"
+#define LZVFS_MAGIC        "RebLZvfs"
+#define LZVFS_VERSION      1
+#define LZVFS_HEADER_SIZE  64
+#define LZVFS_DATA_START   (2 * LZVFS_HEADER_SIZE)
+#define LZVFS_ENTRY_SIZE   16
+#define LZVFS_CACHE_SLOTS  64
+#define LZVFS_DEFAULT_PAGE 4096
+
+#define LZVFS_RAW          1  // record is stored uncompressed
+
+typedef struct lzvfs_entry {
+	sqlite3_int64 offset; // 0 = page was never written (zeros)
+	u32 length;
+	u32 flags;
+} LZVFS_ENTRY;
+
+typedef struct lzvfs_extent {
+	sqlite3_int64 offset;
+	sqlite3_int64 length;
+} LZVFS_EXTENT;
+
+typedef struct lzvfs_extents {
+	LZVFS_EXTENT *items;
+	int count;
+	int alloc;
+} LZVFS_EXTENTS;
+
+typedef struct lzvfs_file {
+	sqlite3_file   base;
+	sqlite3_file  *real;         // underlying file (allocated after this struct)
+	int            lock;
+	int            dirty;
+	u32            page_size;
+	u64            generation;
+	sqlite3_int64  file_size;    // logical (uncompressed) size
+	sqlite3_int64  data_end;     // physical end of used space
+	sqlite3_int64  index_offset;
+	u32            index_bytes;
+	LZVFS_ENTRY   *index;
+	u32            index_count;
+	u32            index_alloc;
+	LZVFS_EXTENTS  free;         // reusable space
+	LZVFS_EXTENTS  pending;      // space reusable after the next header write
+	sqlite3_int64  cache_page[LZVFS_CACHE_SLOTS];
+	REBYTE        *cache;        // LZVFS_CACHE_SLOTS decompressed pages
+	REBYTE        *work;         // compression/decompression buffer
+	u32            buffer_size;  // page size used to allocate above buffers
+} LZVFS_FILE;
+
+static sqlite3_vfs lzvfs;
+#define REAL_VFS ((sqlite3_vfs*)lzvfs.pAppData)
+
+//-- little endian helpers -----------------------------------------------------
+static void put32(REBYTE *p, u32 v) {
+	p[0] = (REBYTE)v; p[1] = (REBYTE)(v >> 8); p[2] = (REBYTE)(v >> 16); p[3] = (REBYTE)(v >> 24);
+}
+static u32 get32(const REBYTE *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+static void put64(REBYTE *p, u64 v) {
+	put32(p, (u32)v); put32(p + 4, (u32)(v >> 32));
+}
+static u64 get64(const REBYTE *p) {
+	return get32(p) | ((u64)get32(p + 4) << 32);
+}
+static u32 checksum(const REBYTE *p, int n) {
+	u32 h = 2166136261U; // FNV-1a
+	while (n--) { h ^= *p++; h *= 16777619U; }
+	return h;
+}
+
+//-- space management ----------------------------------------------------------
+static int extents_add(LZVFS_EXTENTS *list, sqlite3_int64 offset, sqlite3_int64 length) {
+	LZVFS_EXTENT *items;
+	if (length <= 0) return SQLITE_OK;
+	if (list->count == list->alloc) {
+		int alloc = list->alloc ? list->alloc * 2 : 64;
+		items = sqlite3_realloc64(list->items, alloc * sizeof(LZVFS_EXTENT));
+		if (!items) return SQLITE_NOMEM;
+		list->items = items;
+		list->alloc = alloc;
+	}
+	list->items[list->count].offset = offset;
+	list->items[list->count].length = length;
+	list->count++;
+	return SQLITE_OK;
+}
+
+static int compare_extents(const void *a, const void *b) {
+	sqlite3_int64 d = ((LZVFS_EXTENT*)a)->offset - ((LZVFS_EXTENT*)b)->offset;
+	return d < 0 ? -1 : (d > 0);
+}
+
+// Sorts the free list, merges neighbours and gives the tail back to the file.
+static void extents_compact(LZVFS_FILE *p) {
+	LZVFS_EXTENTS *list = &p->free;
+	int i, n = 0;
+	if (list->count == 0) return;
+	qsort(list->items, list->count, sizeof(LZVFS_EXTENT), compare_extents);
+	for (i = 1; i < list->count; i++) {
+		if (list->items[n].offset + list->items[n].length == list->items[i].offset) {
+			list->items[n].length += list->items[i].length;
+		} else {
+			list->items[++n] = list->items[i];
+		}
+	}
+	list->count = n + 1;
+	if (list->items[n].offset + list->items[n].length >= p->data_end) {
+		p->data_end = list->items[n].offset;
+		list->count--;
+	}
+}
+
+static sqlite3_int64 space_alloc(LZVFS_FILE *p, sqlite3_int64 length) {
+	LZVFS_EXTENTS *list = &p->free;
+	sqlite3_int64 offset;
+	int i;
+	for (i = 0; i < list->count; i++) {
+		if (list->items[i].length >= length) {
+			offset = list->items[i].offset;
+			list->items[i].offset += length;
+			list->items[i].length -= length;
+			if (list->items[i].length == 0) list->items[i] = list->items[--list->count];
+			return offset;
+		}
+	}
+	offset = p->data_end;
+	p->data_end += length;
+	return offset;
+}
+
+//-- header and index ----------------------------------------------------------
+static void reset_state(LZVFS_FILE *p) {
+	int i;
+	p->page_size = 0;
+	p->generation = 0;
+	p->file_size = 0;
+	p->data_end = LZVFS_DATA_START;
+	p->index_offset = 0;
+	p->index_bytes = 0;
+	p->index_count = 0;
+	p->free.count = 0;
+	p->pending.count = 0;
+	for (i = 0; i < LZVFS_CACHE_SLOTS; i++) p->cache_page[i] = -1;
+}
+
+// Reads both header slots and returns the generation of the newest valid one (0 = none).
+// `blank` is set when there is nothing in the header area (crash before the first flush).
+static u64 read_header(LZVFS_FILE *p, REBYTE *best, int *blank) {
+	REBYTE buf[LZVFS_DATA_START];
+	REBYTE *h;
+	u64 gen, top = 0;
+	int i, rc;
+
+	memset(buf, 0, sizeof(buf));
+	rc = p->real->pMethods->xRead(p->real, buf, LZVFS_DATA_START, 0);
+	if (rc != SQLITE_OK && rc != SQLITE_IOERR_SHORT_READ) return 0;
+	*blank = 1;
+	for (i = 0; i < LZVFS_DATA_START; i++) {
+		if (buf[i]) { *blank = 0; break; }
+	}
+	for (i = 0; i < 2; i++) {
+		h = buf + (i * LZVFS_HEADER_SIZE);
+		if (memcmp(h, LZVFS_MAGIC, 8) || get32(h + 8) != LZVFS_VERSION) continue;
+		if (get32(h + 56) != checksum(h, 56)) continue;
+		gen = get64(h + 16);
+		if (gen > top) {
+			top = gen;
+			memcpy(best, h, LZVFS_HEADER_SIZE);
+		}
+	}
+	return top;
+}
+
+static int load_state(LZVFS_FILE *p) {
+	REBYTE hdr[LZVFS_HEADER_SIZE];
+	REBYTE *buf;
+	LZVFS_EXTENT *used;
+	LZVFS_ENTRY *e;
+	sqlite3_int64 size, pos;
+	u64 gen;
+	u32 i, n, bound;
+	int rc, blank = 0;
+
+	rc = p->real->pMethods->xFileSize(p->real, &size);
+	if (rc != SQLITE_OK) return rc;
+
+	gen = read_header(p, hdr, &blank);
+	if (gen == 0) {
+		if (size > 0 && !blank) return SQLITE_NOTADB; // not a compressed database
+		reset_state(p);
+		return SQLITE_OK;
+	}
+	if (gen == p->generation) return SQLITE_OK; // nothing changed since last time
+
+	reset_state(p);
+	p->generation   = gen;
+	p->page_size    = get32(hdr + 12);
+	p->file_size    = get64(hdr + 24);
+	p->data_end     = get64(hdr + 32);
+	p->index_offset = get64(hdr + 40);
+	n               = get32(hdr + 48);
+	// values of the header are checked before they are used for any access
+	if (p->page_size < 512 || p->page_size > 65536 || (p->page_size & (p->page_size - 1))
+	 || n > size / LZVFS_ENTRY_SIZE
+	 || (n && (p->index_offset < LZVFS_DATA_START || p->index_offset + (sqlite3_int64)n * LZVFS_ENTRY_SIZE > size))) {
+		reset_state(p);
+		return SQLITE_CORRUPT;
+	}
+	p->index_bytes  = n * LZVFS_ENTRY_SIZE;
+
+	if (n > p->index_alloc) {
+		LZVFS_ENTRY *index = sqlite3_realloc64(p->index, n * sizeof(LZVFS_ENTRY));
+		if (!index) return SQLITE_NOMEM;
+		p->index = index;
+		p->index_alloc = n;
+	}
+	p->index_count = n;
+	if (n == 0) return SQLITE_OK;
+
+	buf = sqlite3_malloc64(p->index_bytes);
+	if (!buf) return SQLITE_NOMEM;
+	rc = p->real->pMethods->xRead(p->real, buf, p->index_bytes, p->index_offset);
+	if (rc != SQLITE_OK) {
+		sqlite3_free(buf);
+		reset_state(p);
+		return SQLITE_CORRUPT;
+	}
+	// a record must fit the work buffer (a raw one is a whole page) and the file
+	bound = (u32)lz4_compress_bound((int)p->page_size);
+	for (i = 0; i < n; i++) {
+		e = &p->index[i];
+		e->offset = get64(buf + i * LZVFS_ENTRY_SIZE);
+		e->length = get32(buf + i * LZVFS_ENTRY_SIZE + 8);
+		e->flags  = get32(buf + i * LZVFS_ENTRY_SIZE + 12);
+		if (e->offset == 0) continue;
+		if (e->length == 0 || e->length > bound
+		 || ((e->flags & LZVFS_RAW) && e->length != p->page_size)
+		 || e->offset < LZVFS_DATA_START || e->offset > size - e->length) {
+			sqlite3_free(buf);
+			reset_state(p);
+			return SQLITE_CORRUPT;
+		}
+	}
+	sqlite3_free(buf);
+
+	// Rebuild the free list from gaps between used extents.
+	used = sqlite3_malloc64((n + 1) * sizeof(LZVFS_EXTENT));
+	if (!used) return SQLITE_NOMEM;
+	used[0].offset = p->index_offset;
+	used[0].length = p->index_bytes;
+	for (i = 0; i < n; i++) {
+		used[i + 1].offset = p->index[i].offset;
+		used[i + 1].length = p->index[i].offset ? p->index[i].length : 0;
+	}
+	qsort(used, n + 1, sizeof(LZVFS_EXTENT), compare_extents);
+	pos = LZVFS_DATA_START;
+	for (i = 0; i <= n; i++) {
+		if (used[i].length == 0) continue;
+		if (used[i].offset > pos) extents_add(&p->free, pos, used[i].offset - pos);
+		if (used[i].offset + used[i].length > pos) pos = used[i].offset + used[i].length;
+	}
+	extents_add(&p->free, pos, p->data_end - pos);
+	sqlite3_free(used);
+	extents_compact(p);
+	return SQLITE_OK;
+}
+
+// Writes the page index and a new header. With sync flags, records and the
+// index are synced before the header, so a header never points to data that
+// did not reach the disk, and the header is synced after. Superseded space
+// becomes reusable only after the header is on the disk.
+static int flush_state(LZVFS_FILE *p, int flags) {
+	REBYTE hdr[LZVFS_HEADER_SIZE];
+	REBYTE *buf = NULL;
+	sqlite3_int64 offset = 0;
+	u32 i, bytes;
+	int rc, j;
+
+	if (!p->dirty) return SQLITE_OK;
+
+	bytes = p->index_count * LZVFS_ENTRY_SIZE;
+	if (bytes) {
+		buf = sqlite3_malloc64(bytes);
+		if (!buf) return SQLITE_NOMEM;
+		for (i = 0; i < p->index_count; i++) {
+			put64(buf + i * LZVFS_ENTRY_SIZE,      p->index[i].offset);
+			put32(buf + i * LZVFS_ENTRY_SIZE + 8,  p->index[i].length);
+			put32(buf + i * LZVFS_ENTRY_SIZE + 12, p->index[i].flags);
+		}
+		offset = space_alloc(p, bytes);
+		rc = p->real->pMethods->xWrite(p->real, buf, bytes, offset);
+		sqlite3_free(buf);
+		if (rc != SQLITE_OK) return rc;
+	}
+	if (flags) {
+		rc = p->real->pMethods->xSync(p->real, flags);
+		if (rc != SQLITE_OK) return rc;
+	}
+	rc = extents_add(&p->pending, p->index_offset, p->index_bytes);
+	if (rc != SQLITE_OK) return rc;
+	p->index_offset = offset;
+	p->index_bytes  = bytes;
+	p->generation++;
+
+	memset(hdr, 0, sizeof(hdr));
+	memcpy(hdr, LZVFS_MAGIC, 8);
+	put32(hdr + 8,  LZVFS_VERSION);
+	put32(hdr + 12, p->page_size);
+	put64(hdr + 16, p->generation);
+	put64(hdr + 24, p->file_size);
+	put64(hdr + 32, p->data_end);
+	put64(hdr + 40, p->index_offset);
+	put32(hdr + 48, p->index_count);
+	put32(hdr + 56, checksum(hdr, 56));
+	rc = p->real->pMethods->xWrite(p->real, hdr, LZVFS_HEADER_SIZE, (p->generation & 1) * LZVFS_HEADER_SIZE);
+	if (rc != SQLITE_OK) return rc;
+	if (flags) {
+		rc = p->real->pMethods->xSync(p->real, flags);
+		if (rc != SQLITE_OK) return rc;
+	}
+	p->dirty = 0;
+
+	for (j = 0; j < p->pending.count; j++) {
+		extents_add(&p->free, p->pending.items[j].offset, p->pending.items[j].length);
+	}
+	p->pending.count = 0;
+	offset = p->data_end;
+	extents_compact(p);
+	if (p->data_end < offset) {
+		// the tail is not referenced by the new header, give it back
+		p->real->pMethods->xTruncate(p->real, p->data_end);
+	}
+	return SQLITE_OK;
+}
+
+//-- page access ---------------------------------------------------------------
+static REBYTE* cache_slot(LZVFS_FILE *p, sqlite3_int64 page) {
+	return p->cache + (page % LZVFS_CACHE_SLOTS) * p->page_size;
+}
+
+// Returns a pointer to the decompressed page (owned by the cache).
+static int read_page(LZVFS_FILE *p, sqlite3_int64 page, REBYTE **out) {
+	LZVFS_ENTRY *e;
+	REBYTE *data = cache_slot(p, page);
+	int slot = (int)(page % LZVFS_CACHE_SLOTS);
+	int rc, n;
+
+	*out = data;
+	if (p->cache_page[slot] == page) return SQLITE_OK;
+	p->cache_page[slot] = -1;
+
+	if (page >= p->index_count || p->index[page].offset == 0) {
+		memset(data, 0, p->page_size);
+	} else {
+		e = &p->index[page];
+		if (e->flags & LZVFS_RAW) {
+			rc = p->real->pMethods->xRead(p->real, data, p->page_size, e->offset);
+			if (rc != SQLITE_OK) return rc;
+		} else {
+			rc = p->real->pMethods->xRead(p->real, p->work, e->length, e->offset);
+			if (rc != SQLITE_OK) return rc;
+			n = lz4_decompress(p->work, e->length, data, p->page_size);
+			if (n < 0) return SQLITE_CORRUPT;
+			if ((u32)n < p->page_size) memset(data + n, 0, p->page_size - n);
+		}
+	}
+	p->cache_page[slot] = page;
+	return SQLITE_OK;
+}
+
+static int write_page(LZVFS_FILE *p, sqlite3_int64 page, const REBYTE *data) {
+	LZVFS_ENTRY *e;
+	const REBYTE *src = p->work;
+	sqlite3_int64 offset;
+	u32 length, flags = 0;
+	int rc;
+
+	if (page >= p->index_alloc) {
+		u32 alloc = p->index_alloc ? p->index_alloc : 64;
+		LZVFS_ENTRY *index;
+		while (alloc <= page) alloc *= 2;
+		index = sqlite3_realloc64(p->index, alloc * sizeof(LZVFS_ENTRY));
+		if (!index) return SQLITE_NOMEM;
+		p->index = index;
+		p->index_alloc = alloc;
+	}
+	while (p->index_count <= page) {
+		e = &p->index[p->index_count++];
+		e->offset = 0;
+		e->length = 0;
+		e->flags = 0;
+	}
+	e = &p->index[page];
+
+	length = lz4_compress(data, p->page_size, p->work, p->page_size - 1);
+	if (length == 0) {
+		src = data;
+		length = p->page_size;
+		flags = LZVFS_RAW;
+	}
+	offset = space_alloc(p, length);
+	rc = p->real->pMethods->xWrite(p->real, src, length, offset);
+	if (rc != SQLITE_OK) return rc;
+
+	if (e->offset) {
+		rc = extents_add(&p->pending, e->offset, e->length);
+		if (rc != SQLITE_OK) return rc;
+	}
+	e->offset = offset;
+	e->length = length;
+	e->flags  = flags;
+	p->dirty  = 1;
+
+	if (data != cache_slot(p, page)) memcpy(cache_slot(p, page), data, p->page_size);
+	p->cache_page[page % LZVFS_CACHE_SLOTS] = page;
+	return SQLITE_OK;
+}
+
+static int init_buffers(LZVFS_FILE *p, u32 page_size) {
+	int i;
+	p->page_size = page_size;
+	if (p->buffer_size == page_size) return SQLITE_OK;
+	sqlite3_free(p->cache);
+	sqlite3_free(p->work);
+	p->cache = sqlite3_malloc64((sqlite3_int64)page_size * LZVFS_CACHE_SLOTS);
+	p->work  = sqlite3_malloc64(lz4_compress_bound(page_size));
+	for (i = 0; i < LZVFS_CACHE_SLOTS; i++) p->cache_page[i] = -1;
+	if (!p->cache || !p->work) {
+		p->buffer_size = 0;
+		return SQLITE_NOMEM;
+	}
+	p->buffer_size = page_size;
+	return SQLITE_OK;
+}
+
+//-- io methods ----------------------------------------------------------------
+static int lzvfsClose(sqlite3_file *pFile) {
+	LZVFS_FILE *p = (LZVFS_FILE*)pFile;
+	int rc = flush_state(p, 0);
+	p->real->pMethods->xClose(p->real);
+	sqlite3_free(p->index);
+	sqlite3_free(p->free.items);
+	sqlite3_free(p->pending.items);
+	sqlite3_free(p->cache);
+	sqlite3_free(p->work);
+	return rc;
+}
+
+static int lzvfsRead(sqlite3_file *pFile, void *zBuf, int iAmt, sqlite3_int64 iOfst) {
+	LZVFS_FILE *p = (LZVFS_FILE*)pFile;
+	REBYTE *out = (REBYTE*)zBuf;
+	REBYTE *data;
+	sqlite3_int64 page;
+	int skip, n, rc;
+
+	if (iOfst + iAmt > p->file_size || p->page_size == 0) {
+		// SQLite requires unread part of the buffer to be zeroed
+		memset(zBuf, 0, iAmt);
+		if (iOfst >= p->file_size || p->page_size == 0) return SQLITE_IOERR_SHORT_READ;
+		iAmt = (int)(p->file_size - iOfst);
+		rc = lzvfsRead(pFile, zBuf, iAmt, iOfst);
+		return rc == SQLITE_OK ? SQLITE_IOERR_SHORT_READ : rc;
+	}
+	while (iAmt > 0) {
+		page = iOfst / p->page_size;
+		skip = (int)(iOfst % p->page_size);
+		n = p->page_size - skip;
+		if (n > iAmt) n = iAmt;
+		rc = read_page(p, page, &data);
+		if (rc != SQLITE_OK) return rc;
+		memcpy(out, data + skip, n);
+		out += n;
+		iOfst += n;
+		iAmt -= n;
+	}
+	return SQLITE_OK;
+}
+
+static int lzvfsWrite(sqlite3_file *pFile, const void *zBuf, int iAmt, sqlite3_int64 iOfst) {
+	LZVFS_FILE *p = (LZVFS_FILE*)pFile;
+	const REBYTE *in = (const REBYTE*)zBuf;
+	REBYTE *data;
+	sqlite3_int64 page;
+	int skip, n, rc;
+
+	if (p->page_size == 0) {
+		// the page size is taken from the first write into an empty database
+		u32 size = LZVFS_DEFAULT_PAGE;
+		if (iAmt >= 512 && iAmt <= 65536 && (iAmt & (iAmt - 1)) == 0 && (iOfst % iAmt) == 0) size = iAmt;
+		rc = init_buffers(p, size);
+		if (rc != SQLITE_OK) return rc;
+	}
+	while (iAmt > 0) {
+		page = iOfst / p->page_size;
+		skip = (int)(iOfst % p->page_size);
+		n = p->page_size - skip;
+		if (n > iAmt) n = iAmt;
+		if (n == (int)p->page_size) {
+			rc = write_page(p, page, in);
+		} else {
+			// partial page update (read-modify-write)
+			rc = read_page(p, page, &data);
+			if (rc != SQLITE_OK) return rc;
+			memcpy(data + skip, in, n);
+			rc = write_page(p, page, data);
+		}
+		if (rc != SQLITE_OK) {
+			p->cache_page[page % LZVFS_CACHE_SLOTS] = -1;
+			return rc;
+		}
+		in += n;
+		iOfst += n;
+		iAmt -= n;
+		if (iOfst > p->file_size) p->file_size = iOfst;
+	}
+	return SQLITE_OK;
+}
+
+static int lzvfsTruncate(sqlite3_file *pFile, sqlite3_int64 size) {
+	LZVFS_FILE *p = (LZVFS_FILE*)pFile;
+	u32 pages, i;
+	int slot;
+
+	if (size >= p->file_size) return SQLITE_OK;
+	pages = p->page_size ? (u32)((size + p->page_size - 1) / p->page_size) : 0;
+	for (i = pages; i < p->index_count; i++) {
+		if (p->index[i].offset) extents_add(&p->pending, p->index[i].offset, p->index[i].length);
+	}
+	if (pages < p->index_count) p->index_count = pages;
+	for (slot = 0; slot < LZVFS_CACHE_SLOTS; slot++) {
+		if (p->cache_page[slot] >= pages) p->cache_page[slot] = -1;
+	}
+	p->file_size = size;
+	p->dirty = 1;
+	return SQLITE_OK;
+}
+
+static int lzvfsSync(sqlite3_file *pFile, int flags) {
+	LZVFS_FILE *p = (LZVFS_FILE*)pFile;
+	if (p->dirty) return flush_state(p, flags);
+	return p->real->pMethods->xSync(p->real, flags);
+}
+
+static int lzvfsFileSize(sqlite3_file *pFile, sqlite3_int64 *pSize) {
+	*pSize = ((LZVFS_FILE*)pFile)->file_size;
+	return SQLITE_OK;
+}
+
+static int lzvfsLock(sqlite3_file *pFile, int eLock) {
+	LZVFS_FILE *p = (LZVFS_FILE*)pFile;
+	int rc = p->real->pMethods->xLock(p->real, eLock);
+	if (rc != SQLITE_OK) return rc;
+	if (p->lock == SQLITE_LOCK_NONE && eLock >= SQLITE_LOCK_SHARED) {
+		// other connection may have changed the file since we have seen it
+		rc = load_state(p);
+		if (rc == SQLITE_OK && p->page_size) rc = init_buffers(p, p->page_size);
+		if (rc != SQLITE_OK) {
+			p->real->pMethods->xUnlock(p->real, SQLITE_LOCK_NONE);
+			return rc;
+		}
+	}
+	p->lock = eLock;
+	return SQLITE_OK;
+}
+
+static int lzvfsUnlock(sqlite3_file *pFile, int eLock) {
+	LZVFS_FILE *p = (LZVFS_FILE*)pFile;
+	int rc;
+	if (p->dirty && eLock <= SQLITE_LOCK_SHARED) {
+		// used with `synchronous=OFF` where xSync is never called
+		rc = flush_state(p, 0);
+		if (rc != SQLITE_OK) return rc;
+	}
+	p->lock = eLock;
+	return p->real->pMethods->xUnlock(p->real, eLock);
+}
+
+static int lzvfsCheckReservedLock(sqlite3_file *pFile, int *pResOut) {
+	LZVFS_FILE *p = (LZVFS_FILE*)pFile;
+	return p->real->pMethods->xCheckReservedLock(p->real, pResOut);
+}
+
+static int lzvfsFileControl(sqlite3_file *pFile, int op, void *pArg) {
+	LZVFS_FILE *p = (LZVFS_FILE*)pFile;
+	int rc;
+	switch (op) {
+		case SQLITE_FCNTL_SIZE_HINT:
+		case SQLITE_FCNTL_CHUNK_SIZE:
+			return SQLITE_OK; // physical layout is not related to the logical size
+		case SQLITE_FCNTL_VFSNAME:
+			rc = p->real->pMethods->xFileControl(p->real, op, pArg);
+			if (rc == SQLITE_OK) *(char**)pArg = sqlite3_mprintf("%s/%z", LZVFS_NAME, *(char**)pArg);
+			return rc;
+	}
+	return p->real->pMethods->xFileControl(p->real, op, pArg);
+}
+
+static int lzvfsSectorSize(sqlite3_file *pFile) {
+	LZVFS_FILE *p = (LZVFS_FILE*)pFile;
+	return p->real->pMethods->xSectorSize(p->real);
+}
+
+static int lzvfsDeviceCharacteristics(sqlite3_file *pFile) {
+	UNUSED(pFile);
+	return 0; // page writes are never atomic nor powersafe
+}
+
+static const sqlite3_io_methods lzvfs_io_methods = {
+	1,
+	lzvfsClose,
+	lzvfsRead,
+	lzvfsWrite,
+	lzvfsTruncate,
+	lzvfsSync,
+	lzvfsFileSize,
+	lzvfsLock,
+	lzvfsUnlock,
+	lzvfsCheckReservedLock,
+	lzvfsFileControl,
+	lzvfsSectorSize,
+	lzvfsDeviceCharacteristics,
+	NULL, // xShmMap (no WAL, see above)
+	NULL, // xShmLock
+	NULL, // xShmBarrier
+	NULL, // xShmUnmap
+	NULL, // xFetch
+	NULL  // xUnfetch
+};
+
+//-- vfs methods ---------------------------------------------------------------
+static int lzvfsOpen(sqlite3_vfs *pVfs, const char *zName, sqlite3_file *pFile, int flags, int *pOutFlags) {
+	LZVFS_FILE *p = (LZVFS_FILE*)pFile;
+	int rc;
+
+	if (!(flags & SQLITE_OPEN_MAIN_DB)) {
+		// journals and temporary files are stored as they are
+		return REAL_VFS->xOpen(REAL_VFS, zName, pFile, flags, pOutFlags);
+	}
+	memset(p, 0, sizeof(LZVFS_FILE));
+	p->real = (sqlite3_file*)&p[1];
+	rc = REAL_VFS->xOpen(REAL_VFS, zName, p->real, flags, pOutFlags);
+	if (rc != SQLITE_OK) return rc;
+
+	p->generation = (u64)-1; // forces loading
+	rc = load_state(p);
+	if (rc == SQLITE_OK && p->page_size) rc = init_buffers(p, p->page_size);
+	if (rc != SQLITE_OK) {
+		p->real->pMethods->xClose(p->real);
+		sqlite3_free(p->index);
+		sqlite3_free(p->free.items);
+		sqlite3_free(p->cache);
+		sqlite3_free(p->work);
+		return rc;
+	}
+	p->base.pMethods = &lzvfs_io_methods;
+	return SQLITE_OK;
+}
+
+static int lzvfsDelete(sqlite3_vfs *pVfs, const char *zName, int syncDir) {
+	return REAL_VFS->xDelete(REAL_VFS, zName, syncDir);
+}
+static int lzvfsAccess(sqlite3_vfs *pVfs, const char *zName, int flags, int *pResOut) {
+	return REAL_VFS->xAccess(REAL_VFS, zName, flags, pResOut);
+}
+static int lzvfsFullPathname(sqlite3_vfs *pVfs, const char *zName, int nOut, char *zOut) {
+	return REAL_VFS->xFullPathname(REAL_VFS, zName, nOut, zOut);
+}
+static void *lzvfsDlOpen(sqlite3_vfs *pVfs, const char *zPath) {
+	return REAL_VFS->xDlOpen(REAL_VFS, zPath);
+}
+static void lzvfsDlError(sqlite3_vfs *pVfs, int nByte, char *zErrMsg) {
+	REAL_VFS->xDlError(REAL_VFS, nByte, zErrMsg);
+}
+static void (*lzvfsDlSym(sqlite3_vfs *pVfs, void *p, const char *zSym))(void) {
+	return REAL_VFS->xDlSym(REAL_VFS, p, zSym);
+}
+static void lzvfsDlClose(sqlite3_vfs *pVfs, void *pHandle) {
+	REAL_VFS->xDlClose(REAL_VFS, pHandle);
+}
+static int lzvfsRandomness(sqlite3_vfs *pVfs, int nByte, char *zBufOut) {
+	return REAL_VFS->xRandomness(REAL_VFS, nByte, zBufOut);
+}
+static int lzvfsSleep(sqlite3_vfs *pVfs, int nMicro) {
+	return REAL_VFS->xSleep(REAL_VFS, nMicro);
+}
+static int lzvfsCurrentTime(sqlite3_vfs *pVfs, double *pTimeOut) {
+	return REAL_VFS->xCurrentTime(REAL_VFS, pTimeOut);
+}
+static int lzvfsGetLastError(sqlite3_vfs *pVfs, int a, char *b) {
+	return REAL_VFS->xGetLastError(REAL_VFS, a, b);
+}
+static int lzvfsCurrentTimeInt64(sqlite3_vfs *pVfs, sqlite3_int64 *p) {
+	return REAL_VFS->xCurrentTimeInt64(REAL_VFS, p);
+}
+
+// Registers the compressed VFS (once); returns its name for sqlite3_open_v2.
+const char* register_compressed_vfs(void) {
+	sqlite3_vfs *real;
+	if (sqlite3_vfs_find(LZVFS_NAME)) return LZVFS_NAME;
+	real = sqlite3_vfs_find(NULL);
+	if (!real) return NULL;
+
+	memset(&lzvfs, 0, sizeof(lzvfs));
+	lzvfs.iVersion          = 2;
+	lzvfs.szOsFile          = sizeof(LZVFS_FILE) + real->szOsFile;
+	lzvfs.mxPathname        = real->mxPathname;
+	lzvfs.zName             = LZVFS_NAME;
+	lzvfs.pAppData          = real;
+	lzvfs.xOpen             = lzvfsOpen;
+	lzvfs.xDelete           = lzvfsDelete;
+	lzvfs.xAccess           = lzvfsAccess;
+	lzvfs.xFullPathname     = lzvfsFullPathname;
+	lzvfs.xDlOpen           = lzvfsDlOpen;
+	lzvfs.xDlError          = lzvfsDlError;
+	lzvfs.xDlSym            = lzvfsDlSym;
+	lzvfs.xDlClose          = lzvfsDlClose;
+	lzvfs.xRandomness       = lzvfsRandomness;
+	lzvfs.xSleep            = lzvfsSleep;
+	lzvfs.xCurrentTime      = lzvfsCurrentTime;
+	lzvfs.xGetLastError     = lzvfsGetLastError;
+	lzvfs.xCurrentTimeInt64 = lzvfsCurrentTimeInt64;
+
+	if (sqlite3_vfs_register(&lzvfs, 0) != SQLITE_OK) return NULL;
+	return LZVFS_NAME;
+}
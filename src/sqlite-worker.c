@@ -0,0 +1,422 @@
+//   ____  __   __        ______        __
+//  / __ \/ /__/ /__ ___ /_  __/__ ____/ /
+// / /_/ / / _  / -_|_-<_ / / / -_) __/ _ \
+// \____/_/\_,_/\__/___(@)_/  \__/\__/_// /
+//  ~~~ oldes.huhuman at gmail.com ~~~ /_/
+//
+// SPDX-License-Identifier: MIT
+// =============================================================================
+// Rebol/SQLite extension
+// =============================================================================
+// Per-connection worker thread evaluating async queries (`eval/async` and
+// `step/async`).
+//
+// Jobs are evaluated in the order they were queued. The worker never touches
+// Rebol values: parameters are captured before the job is queued and rows are
+// kept in a raw buffer until the `result` command converts them. The host API
+// is not thread-safe, so finished jobs are not announced from here: they wait
+// in the done list until the interpreter's thread takes them by `result`
+// (which may block on the worker's lock until one is finished).
+//
+// With `group-commit`, consecutive async writes are evaluated in one
+// transaction, which is committed when it has enough writes or when the
+// first one waited long enough. Each write still gets its own result.
+//
+// The connection is shared with the interpreter's thread, so it is allowed
+// only in the serialized threading mode.
+
+#include "sqlite-rebol-extension.h"
+
+static void job_failed(SQLITE_JOB *job, int rc, const char *error) {
+	job->rc = rc;
+	sqlite3_free(job->error);
+	job->error = sqlite3_mprintf("%s", error);
+}
+
+// Keeps the connection's message (like "no such table: X") while the worker
+// still owns the connection.
+static void job_error(SQLITE_JOB *job, sqlite3 *db, int rc) {
+	job->rc = rc;
+	sqlite3_free(job->error);
+	if (rc == SQLITE_INTERRUPT) job->error = sqlite3_mprintf("%s", interrupt_message());
+	else job->error = sqlite3_mprintf("%s %s", sqlite3_errstr(rc), sqlite3_errmsg(db));
+}
+
+static void run_eval(SQLITE_JOB *job) {
+	sqlite3_stmt *stmt = job->stmt;
+	sqlite3 *db = sqlite3_db_handle(stmt);
+	size_t pos = 0;
+	i64 set = 0;
+	int rc = SQLITE_OK;
+
+	if (job->ctxStmt && job->ctxStmt->last_result_code == SQLITE_DONE) sqlite3_reset(stmt);
+	if (job->params.count) {
+		rc = rows_bind(&job->params, &pos, stmt);
+		set++;
+	}
+	while (rc == SQLITE_OK) {
+		rc = stmt_step(job->ctxStmt ? &job->steps : NULL, stmt);
+		if (job->ctxStmt) job->ctxStmt->last_result_code = rc;
+		if (rc == SQLITE_ROW) {
+			rc = rows_append(&job->rows, stmt);
+			continue;
+		}
+		if (rc != SQLITE_DONE) break;
+		rc = SQLITE_OK;
+		if (job->rows.count) break;
+		job->changes += sqlite3_changes(db);
+		sqlite3_reset(stmt);
+		// evaluate the statement with the next parameter set
+		if (set >= job->params.count) break;
+		rc = rows_bind(&job->params, &pos, stmt);
+		set++;
+	}
+	if (rc != SQLITE_OK) job_error(job, db, rc);
+	if (!job->ctxStmt) {
+		sqlite3_finalize(stmt);
+		job->stmt = NULL;
+	}
+}
+
+static void run_step(SQLITE_JOB *job) {
+	sqlite3_stmt *stmt = job->stmt;
+	SQLITE_STMT *ctxStmt = job->ctxStmt;
+	size_t pos = 0;
+	i64 row;
+	int rc;
+
+	if (job->params.count) rows_bind(&job->params, &pos, stmt);
+
+	rc = sqlite3_stmt_readonly(stmt) ? ctxStmt->last_result_code : SQLITE_ROW;
+
+	for (row = 0; rc == SQLITE_ROW && (!job->maxRows || row < job->maxRows); row++) {
+		rc = stmt_step(&job->steps, stmt);
+		ctxStmt->last_result_code = rc;
+		switch (rc) {
+		case SQLITE_ROW:
+			if (SQLITE_OK != rows_append(&job->rows, stmt)) {
+				job_failed(job, SQLITE_NOMEM, sqlite3_errstr(SQLITE_NOMEM));
+				return;
+			}
+			break;
+		case SQLITE_DONE:
+			if (!job->rows.count) sqlite3_reset(stmt);
+			return;
+		case SQLITE_BUSY:
+			job_failed(job, rc, "Statement is busy!");
+			return;
+		case SQLITE_MISUSE:
+			job_failed(job, rc, "Statement misuse!");
+			return;
+		}
+	}
+	if (rc < SQLITE_ROW && rc != SQLITE_OK) {
+		// the message is taken before the reset, which may replace it
+		job_error(job, sqlite3_db_handle(stmt), rc);
+		rc = sqlite3_reset(stmt);
+		if (rc != SQLITE_OK && rc != job->rc) job_error(job, sqlite3_db_handle(stmt), rc);
+	}
+}
+
+// Writes which may be committed together with other ones.
+static REBOOL groupable(SQLITE_JOB *job) {
+	return !job->step && !sqlite3_stmt_readonly(job->stmt);
+}
+
+// Waits (locked) until the batch is full, its delay is over or it cannot grow.
+static void wait_batch(SQLITE_WORKER *worker) {
+	SQLITE_JOB *job;
+	int count;
+	i64 left;
+
+	for (;;) {
+		count = 0;
+		for (job = worker->queue; job && groupable(job); job = job->next) count++;
+		// a queued job which is not a write ends the batch
+		if (worker->stop || job || count >= worker->group_writes) return;
+		left = worker->queue->queued + worker->group_delay - monotonic_ms();
+		if (left <= 0) return;
+		lock_wait_ms(worker->lock, (int)left);
+	}
+}
+
+// Evaluates the writes in one transaction, each one in its own savepoint,
+// so a failed write does not change results of the others.
+static void run_batch(sqlite3 *db, SQLITE_JOB *batch) {
+	SQLITE_JOB *job, *first = batch;
+	// a transaction already started on the connection is joined
+	REBOOL own = sqlite3_get_autocommit(db);
+	int rc = own ? sqlite3_exec(db, "BEGIN IMMEDIATE", NULL, NULL, NULL) : SQLITE_OK;
+
+	for (job = batch; job; job = job->next) {
+		if (rc != SQLITE_OK) {
+			job_error(job, db, rc);
+			continue;
+		}
+		sqlite3_exec(db, "SAVEPOINT job", NULL, NULL, NULL);
+		deadline_start(db, job->time_limit);
+		run_eval(job);
+		deadline_clear();
+		if (sqlite3_get_autocommit(db)) {
+			// some errors roll back the whole transaction
+			if (!own) continue;
+			for (; first != job; first = first->next) job_failed(first, job->rc, job->error);
+			first = job->next;
+			rc = sqlite3_exec(db, "BEGIN IMMEDIATE", NULL, NULL, NULL);
+			continue;
+		}
+		sqlite3_exec(db, job->rc == SQLITE_OK ? "RELEASE job" : "ROLLBACK TO job; RELEASE job", NULL, NULL, NULL);
+	}
+	if (!own || rc != SQLITE_OK || !first) return;
+	rc = sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		for (job = first; job; job = job->next) job_error(job, db, rc);
+		sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+	}
+}
+
+// Moves the finished job (locked) to the done list, where `result` finds it.
+static void job_done(SQLITE_WORKER *worker, SQLITE_JOB *job) {
+	SQLITE_JOB **tail;
+
+	if (job->ctxStmt) {
+		steps_add(&job->ctxStmt->steps, &job->steps);
+		job->ctxStmt->busy = FALSE;
+	}
+	job->next = NULL;
+	for (tail = &worker->done; *tail; tail = &(*tail)->next);
+	*tail = job;
+}
+
+static void worker_main(void *data) {
+	SQLITE_WORKER *worker = (SQLITE_WORKER*)data;
+	SQLITE_JOB *job, *next, **tail;
+	sqlite3 *db;
+	int count;
+
+	lock_enter(worker->lock);
+	for (;;) {
+		while (!worker->queue && !worker->stop) lock_wait(worker->lock);
+		// when stopped, the rest of the queue is still evaluated
+		if (!(job = worker->queue)) break;
+		db = sqlite3_db_handle(job->stmt);
+
+		if (worker->group_delay > 0 && groupable(job)) {
+			wait_batch(worker);
+			// takes the batch from the head of the queue
+			tail = &worker->queue;
+			for (count = 0; *tail && count < worker->group_writes && groupable(*tail); count++)
+				tail = &(*tail)->next;
+			worker->queue = *tail;
+			*tail = NULL;
+		}
+		else {
+			worker->queue = job->next;
+			job->next = NULL;
+		}
+		worker->current = job;
+		lock_leave(worker->lock);
+
+		if (job->next) run_batch(db, job);
+		else {
+			deadline_start(db, job->time_limit);
+			if (job->step) run_step(job);
+			else run_eval(job);
+			deadline_clear();
+		}
+
+		lock_enter(worker->lock);
+		worker->current = NULL;
+		// results of a batch are available after the commit
+		for (; job; job = next) {
+			next = job->next;
+			job_done(worker, job);
+		}
+		// wakes `result/wait` and `worker_wait_stmt`
+		lock_notify(worker->lock);
+	}
+	lock_leave(worker->lock);
+}
+
+static SQLITE_WORKER* worker_get(SQLITE_CONTEXT *ctx) {
+	SQLITE_WORKER *worker = ctx->worker;
+	if (worker) return worker;
+
+	worker = calloc(1, sizeof(SQLITE_WORKER));
+	if (!worker) return NULL;
+	worker->lock = lock_new();
+	if (worker->lock) worker->thread = thread_start(worker_main, worker);
+	if (!worker->thread) {
+		if (worker->lock) lock_free(worker->lock);
+		free(worker);
+		return NULL;
+	}
+	worker->refs = 1;
+	ctx->worker = worker;
+	return worker;
+}
+
+static int worker_submit(SQLITE_WORKER *worker, SQLITE_JOB *job) {
+	SQLITE_JOB **tail;
+	SQLITE_STMT *ctxStmt = job->ctxStmt;
+
+	if (ctxStmt) {
+		ctxStmt->busy = TRUE;
+		if (!ctxStmt->worker) {
+			ctxStmt->worker = worker;
+			worker->refs++;
+		}
+	}
+	lock_enter(worker->lock);
+	job->id = ++worker->next_id;
+	job->queued = monotonic_ms();
+	for (tail = &worker->queue; *tail; tail = &(*tail)->next);
+	*tail = job;
+	lock_notify(worker->lock);
+	lock_leave(worker->lock);
+	return job->id;
+}
+
+REBOOL worker_allowed(void) {
+	return sqlite3_threadsafe()
+		&& threading_mode != SQLITE_CONFIG_SINGLETHREAD
+		&& threading_mode != SQLITE_CONFIG_MULTITHREAD;
+}
+
+// Queues the statement as `eval` would evaluate it, including all parameter sets
+// (limit is ms for the whole job, 0 = no limit).
+int worker_eval(SQLITE_CONTEXT *ctx, sqlite3_stmt *stmt, SQLITE_STMT *ctxStmt, REBSER *params, REBCNT index, int limit, int *id) {
+	SQLITE_WORKER *worker;
+	SQLITE_JOB *job;
+	RXIARG arg;
+	int count, rc = SQLITE_OK;
+
+	if (!(worker = worker_get(ctx))) return SQLITE_NOMEM;
+	if (!(job = calloc(1, sizeof(SQLITE_JOB)))) return SQLITE_NOMEM;
+	job->stmt    = stmt;
+	job->ctxStmt = ctxStmt;
+	job->time_limit = limit;
+
+	if (params) {
+		count = sqlite3_bind_parameter_count(stmt);
+		do {
+			if (RXT_BLOCK == RL_GET_VALUE_RESOLVED(params, index, &arg)) {
+				rc = rows_capture(&job->params, arg.series, arg.index, count);
+				index++;
+			} else {
+				rc = rows_capture(&job->params, params, index, count);
+				index += count;
+			}
+		} while (rc == SQLITE_OK && count > 0 && index < SERIES_TAIL(params));
+	}
+	if (rc != SQLITE_OK) {
+		job->stmt = NULL; // finalized by the caller
+		job_free(job);
+		return rc;
+	}
+	*id = worker_submit(worker, job);
+	return SQLITE_OK;
+}
+
+// Queues `step` of the prepared statement (maxRows 0 = all rows).
+int worker_step(SQLITE_STMT *ctxStmt, i64 maxRows, REBSER *params, int *id) {
+	SQLITE_CONTEXT *ctx;
+	SQLITE_WORKER *worker;
+	SQLITE_JOB *job;
+	int rc = SQLITE_OK;
+
+	ctx = sqlite3_get_clientdata(sqlite3_db_handle(ctxStmt->stmt), SQLITE_CTX_KEY);
+	if (!ctx) return SQLITE_MISUSE; // not opened by the `open` command
+	if (!(worker = worker_get(ctx))) return SQLITE_NOMEM;
+	if (!(job = calloc(1, sizeof(SQLITE_JOB)))) return SQLITE_NOMEM;
+	job->step    = TRUE;
+	job->stmt    = ctxStmt->stmt;
+	job->ctxStmt = ctxStmt;
+	job->maxRows = maxRows;
+	job->time_limit = deadline_limit(sqlite3_db_handle(ctxStmt->stmt), ctxStmt);
+
+	if (params) rc = rows_capture(&job->params, params, 0, SERIES_TAIL(params));
+	if (rc != SQLITE_OK) {
+		job_free(job);
+		return rc;
+	}
+	*id = worker_submit(worker, job);
+	return SQLITE_OK;
+}
+
+// Sets how async writes are committed together (delay 0 = each one alone).
+int worker_group_commit(SQLITE_CONTEXT *ctx, int delay, int writes) {
+	SQLITE_WORKER *worker;
+
+	if (!(worker = worker_get(ctx))) return SQLITE_NOMEM;
+	lock_enter(worker->lock);
+	worker->group_delay  = delay;
+	worker->group_writes = writes;
+	lock_notify(worker->lock); // the current batch may be already complete
+	lock_leave(worker->lock);
+	return SQLITE_OK;
+}
+
+// Returns the oldest finished job or NULL (main thread only). When some job
+// is still queued or running, waits for it at most `wait` ms and sets `*late`
+// if none was finished in time.
+SQLITE_JOB* worker_take(SQLITE_WORKER *worker, int wait, REBOOL *late) {
+	SQLITE_JOB *job;
+	i64 end = monotonic_ms() + wait, left;
+
+	lock_enter(worker->lock);
+	while (wait > 0 && !worker->done && (worker->queue || worker->current)) {
+		left = end - monotonic_ms();
+		if (left <= 0) {
+			*late = TRUE;
+			break;
+		}
+		lock_wait_ms(worker->lock, (int)left);
+	}
+	job = worker->done;
+	if (job) {
+		worker->done = job->next;
+		job->next = NULL;
+	}
+	lock_leave(worker->lock);
+	return job;
+}
+
+// Blocks until the statement is not used by any job.
+void worker_wait_stmt(SQLITE_WORKER *worker, SQLITE_STMT *ctxStmt) {
+	lock_enter(worker->lock);
+	while (ctxStmt->busy && worker->thread) lock_wait(worker->lock);
+	lock_leave(worker->lock);
+}
+
+// Finishes all queued jobs and stops the thread. Not taken results are dropped.
+void worker_stop(SQLITE_WORKER *worker) {
+	SQLITE_JOB *job;
+
+	if (!worker->thread) return;
+	lock_enter(worker->lock);
+	worker->stop = TRUE;
+	lock_notify(worker->lock);
+	lock_leave(worker->lock);
+	thread_join(worker->thread);
+	worker->thread = NULL;
+
+	while ((job = worker->done)) {
+		worker->done = job->next;
+		job_free(job);
+	}
+}
+
+void worker_release(SQLITE_WORKER *worker) {
+	if (--worker->refs > 0) return;
+	lock_free(worker->lock);
+	free(worker);
+}
+
+void job_free(SQLITE_JOB *job) {
+	if (job->stmt && !job->ctxStmt) sqlite3_finalize(job->stmt);
+	rows_free(&job->params);
+	rows_free(&job->rows);
+	sqlite3_free(job->error);
+	free(job);
+}